@@ -0,0 +1,76 @@
+#include "energycounter.h"
+#include <QTest>
+
+namespace {
+constexpr qint64 kSecondNs = 1000000000;
+constexpr quint64 kCounter32Range = Q_UINT64_C(1) << 32;
+} // namespace
+
+class EnergyCounterTest : public QObject {
+  Q_OBJECT
+
+private slots:
+  void measuresPower();
+  void handlesWrap32();
+  void rejectsImplausibleWrap32();
+  void rejectsReset64();
+  void rejectsShortInterval();
+};
+
+void EnergyCounterTest::measuresPower() {
+  double watts = -1;
+  QVERIFY(EnergyCounter::powerBetween(5000000, kSecondNs, 105000000,
+                                      2 * kSecondNs, false, &watts));
+  QCOMPARE(watts, 100.0);
+
+  // An idle GPU whose counter did not move
+  QVERIFY(EnergyCounter::powerBetween(5000000, kSecondNs, 5000000,
+                                      2 * kSecondNs, true, &watts));
+  QCOMPARE(watts, 0.0);
+}
+
+void EnergyCounterTest::handlesWrap32() {
+  double watts = -1;
+  QVERIFY(EnergyCounter::powerBetween(kCounter32Range - 50000000, 0,
+                                      50000000, kSecondNs, true, &watts));
+  QCOMPARE(watts, 100.0);
+}
+
+void EnergyCounterTest::rejectsImplausibleWrap32() {
+  // A reset of a 32 bit counter would read as a wrap of about 3.3 kW
+  double watts = -1;
+  QVERIFY(!EnergyCounter::powerBetween(1000000000, 0, 1000, kSecondNs, true,
+                                       &watts));
+  QCOMPARE(watts, -1.0);
+}
+
+void EnergyCounterTest::rejectsReset64() {
+  // Counters extended to 64 bit never wrap, any decrease is a reset
+  double watts = -1;
+  QVERIFY(!EnergyCounter::powerBetween(Q_UINT64_C(5000000000000), 0, 1000,
+                                       kSecondNs, false, &watts));
+  QVERIFY(!EnergyCounter::powerBetween(kCounter32Range - 50000000, 0,
+                                       50000000, kSecondNs, false, &watts));
+
+  // A value above 32 bit can't have wrapped at 2^32 either
+  QVERIFY(!EnergyCounter::powerBetween(Q_UINT64_C(5000000000000), 0, 1000,
+                                       kSecondNs, true, &watts));
+  QCOMPARE(watts, -1.0);
+}
+
+void EnergyCounterTest::rejectsShortInterval() {
+  double watts = -1;
+  QVERIFY(!EnergyCounter::powerBetween(5000000, kSecondNs, 6000000,
+                                       kSecondNs, false, &watts));
+  QVERIFY(!EnergyCounter::powerBetween(5000000, kSecondNs, 6000000,
+                                       kSecondNs - 1000000, false, &watts));
+
+  // Below 1 ms the counter granularity dominates
+  QVERIFY(!EnergyCounter::powerBetween(5000000, kSecondNs, 6000000,
+                                       kSecondNs + 500000, false, &watts));
+  QCOMPARE(watts, -1.0);
+}
+
+QTEST_GUILESS_MAIN(EnergyCounterTest)
+
+#include "energycountertest.moc"
@@ -0,0 +1,141 @@
+#include "gpumetrics.h"
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+namespace {
+// Synthetic tables in the layout of kgd_pp_interface.h, as read from
+// /sys/class/drm/cardN/device/gpu_metrics, not captured from a GPU
+QByteArray fixture(const QString &name) {
+  QFile file(QFINDTESTDATA("data/" + name));
+  if (!file.open(QIODevice::ReadOnly)) {
+    return QByteArray();
+  }
+  return file.readAll();
+}
+} // namespace
+
+class GpuMetricsTest : public QObject {
+  Q_OBJECT
+
+private slots:
+  void parsesV1_0();
+  void parsesV1_1();
+  void rejectsV2();
+  void rejectsNewerV1();
+  void rejectsTruncatedTable();
+  void readsFromDevice();
+  void fallsBackOnUnsupportedDevice();
+};
+
+void GpuMetricsTest::parsesV1_0() {
+  QByteArray table = fixture("gpu_metrics_v1_0.bin");
+  QCOMPARE(table.size(), 80);
+
+  GpuMetrics metrics;
+  QVERIFY(GpuMetricsReader::parse(table.constData(), table.size(), &metrics));
+  QCOMPARE(metrics.formatRevision, 1);
+  QCOMPARE(metrics.contentRevision, 0);
+  QCOMPARE(metrics.edgeTemperature, 52.0);
+  QCOMPARE(metrics.hotspotTemperature, 61.0);
+  QCOMPARE(metrics.memoryTemperature, 66.0);
+  QCOMPARE(metrics.gfxActivity, 37);
+  QCOMPARE(metrics.socketPower, 142.0);
+
+  // The current gfx clock is not filled in, the average is used instead
+  QCOMPARE(metrics.gfxClock, 1780);
+  QCOMPARE(metrics.memoryClock, 875);
+  QCOMPARE(metrics.throttleStatus, 0u);
+  QCOMPARE(metrics.fanSpeed, 1421);
+}
+
+void GpuMetricsTest::parsesV1_1() {
+  QByteArray table = fixture("gpu_metrics_v1_1.bin");
+  // Up to temperature_hbm[4]
+  QCOMPARE(table.size(), 96);
+
+  GpuMetrics metrics;
+  QVERIFY(GpuMetricsReader::parse(table.constData(), table.size(), &metrics));
+  QCOMPARE(metrics.contentRevision, 1);
+  QCOMPARE(metrics.edgeTemperature, 48.0);
+  QCOMPARE(metrics.hotspotTemperature, 55.0);
+  QCOMPARE(metrics.memoryTemperature, -1.0);
+  QCOMPARE(metrics.gfxActivity, 99);
+  QCOMPARE(metrics.socketPower, 287.0);
+  QCOMPARE(metrics.gfxClock, 2410);
+  QCOMPARE(metrics.memoryClock, 1000);
+  QCOMPARE(metrics.throttleStatus, 0x40u);
+  QCOMPARE(metrics.fanSpeed, 1890);
+}
+
+void GpuMetricsTest::rejectsV2() {
+  QByteArray table = fixture("gpu_metrics_v2_0.bin");
+  QVERIFY(!table.isEmpty());
+
+  GpuMetrics metrics;
+  QVERIFY(
+      !GpuMetricsReader::parse(table.constData(), table.size(), &metrics));
+  QCOMPARE(metrics.formatRevision, 2);
+  QCOMPARE(metrics.socketPower, -1.0);
+}
+
+void GpuMetricsTest::rejectsNewerV1() {
+  // v1.4 and later are the data center layouts
+  QByteArray table = fixture("gpu_metrics_v1_1.bin");
+  table[3] = 4;
+
+  GpuMetrics metrics;
+  QVERIFY(
+      !GpuMetricsReader::parse(table.constData(), table.size(), &metrics));
+}
+
+void GpuMetricsTest::rejectsTruncatedTable() {
+  QByteArray table = fixture("gpu_metrics_v1_1.bin");
+
+  GpuMetrics metrics;
+  QVERIFY(!GpuMetricsReader::parse(table.constData(), 2, &metrics));
+  QVERIFY(!GpuMetricsReader::parse(table.constData(), 60, &metrics));
+}
+
+void GpuMetricsTest::readsFromDevice() {
+  QTemporaryDir device;
+  QVERIFY(device.isValid());
+  QVERIFY(QFile::copy(QFINDTESTDATA("data/gpu_metrics_v1_1.bin"),
+                      device.filePath("gpu_metrics")));
+
+  GpuMetricsReader reader;
+  reader.setDevicePath(device.path());
+  QVERIFY(reader.isSupported());
+
+  GpuMetrics metrics;
+  QVERIFY(reader.read(&metrics));
+  QCOMPARE(metrics.socketPower, 287.0);
+
+  // The file stays open, every sample is read again from the start
+  QVERIFY(reader.read(&metrics));
+  QCOMPARE(metrics.edgeTemperature, 48.0);
+}
+
+void GpuMetricsTest::fallsBackOnUnsupportedDevice() {
+  QTemporaryDir device;
+  QVERIFY(device.isValid());
+  QVERIFY(QFile::copy(QFINDTESTDATA("data/gpu_metrics_v2_0.bin"),
+                      device.filePath("gpu_metrics")));
+
+  GpuMetricsReader reader;
+  reader.setDevicePath(device.path());
+  QVERIFY(reader.isSupported());
+
+  GpuMetrics metrics;
+  QVERIFY(!reader.read(&metrics));
+  QVERIFY(!reader.isSupported());
+
+  // Without a gpu_metrics file the reader is unsupported right away
+  GpuMetricsReader missing;
+  missing.setDevicePath(device.filePath("missing"));
+  QVERIFY(!missing.isSupported());
+}
+
+QTEST_GUILESS_MAIN(GpuMetricsTest)
+
+#include "gpumetricstest.moc"
@@ -0,0 +1,121 @@
+#include "powermonitor.h"
+#include "ueventmonitor.h"
+#include <QSignalSpy>
+#include <QTest>
+
+namespace {
+// A datagram as the kernel sends it on NETLINK_KOBJECT_UEVENT, every field
+// is terminated by a NUL
+QByteArray datagram(const QList<QByteArray> &fields) {
+  QByteArray message;
+  for (const QByteArray &field : fields) {
+    message.append(field);
+    message.append('\0');
+  }
+  return message;
+}
+
+const QByteArray kHwmonPath =
+    "/devices/pci0000:00/0000:00:01.1/0000:03:00.0/hwmon/hwmon4";
+} // namespace
+
+class UeventMonitorTest : public QObject {
+  Q_OBJECT
+
+private slots:
+  void parsesKernelEvent();
+  void rejectsUdevEvent();
+  void rejectsEventWithoutAction();
+  void ignoresOtherSubsystems();
+  void ignoresChangeEvents();
+  void reprobesEventsDuringProbe();
+};
+
+void UeventMonitorTest::parsesKernelEvent() {
+  Uevent event;
+  QVERIFY(UeventMonitor::parse(datagram({"add@" + kHwmonPath,
+                                         "ACTION=add", "DEVPATH=" + kHwmonPath,
+                                         "SUBSYSTEM=hwmon", "NAME=amdgpu",
+                                         "SEQNUM=4711"}),
+                               &event));
+
+  QCOMPARE(event.action, QString("add"));
+  QCOMPARE(event.devpath, QString::fromLatin1(kHwmonPath));
+  QCOMPARE(event.subsystem, QString("hwmon"));
+  QCOMPARE(event.properties.value("NAME"), QString("amdgpu"));
+  QCOMPARE(event.properties.value("SEQNUM"), QString("4711"));
+}
+
+void UeventMonitorTest::rejectsUdevEvent() {
+  // udevd rebroadcasts on another group with a binary header
+  Uevent event;
+  QVERIFY(!UeventMonitor::parse(
+      datagram({"libudev", "ACTION=add", "DEVPATH=" + kHwmonPath}), &event));
+}
+
+void UeventMonitorTest::rejectsEventWithoutAction() {
+  Uevent event;
+  QVERIFY(!UeventMonitor::parse(
+      datagram({"add@" + kHwmonPath, "SUBSYSTEM=hwmon"}), &event));
+}
+
+void UeventMonitorTest::ignoresOtherSubsystems() {
+  Uevent event;
+  QVERIFY(UeventMonitor::parse(
+      datagram({"add@/devices/virtual/net/veth0", "ACTION=add",
+                "DEVPATH=/devices/virtual/net/veth0", "SUBSYSTEM=net"}),
+      &event));
+
+  PowerMonitor monitor;
+  monitor.handleUevent(event);
+  QVERIFY(!monitor.isProbing());
+}
+
+void UeventMonitorTest::ignoresChangeEvents() {
+  Uevent event;
+  QVERIFY(UeventMonitor::parse(datagram({"change@" + kHwmonPath,
+                                         "ACTION=change",
+                                         "DEVPATH=" + kHwmonPath,
+                                         "SUBSYSTEM=hwmon"}),
+                               &event));
+
+  PowerMonitor monitor;
+  monitor.handleUevent(event);
+  QVERIFY(!monitor.isProbing());
+}
+
+void UeventMonitorTest::reprobesEventsDuringProbe() {
+  Uevent added;
+  QVERIFY(UeventMonitor::parse(datagram({"add@" + kHwmonPath, "ACTION=add",
+                                         "DEVPATH=" + kHwmonPath,
+                                         "SUBSYSTEM=hwmon"}),
+                               &added));
+  Uevent drmAdded;
+  QVERIFY(UeventMonitor::parse(
+      datagram({"add@/devices/pci0000:00/0000:00:01.1/0000:03:00.0/drm/card1",
+                "ACTION=add",
+                "DEVPATH=/devices/pci0000:00/0000:00:01.1/0000:03:00.0/drm/"
+                "card1",
+                "SUBSYSTEM=drm"}),
+      &drmAdded));
+
+  PowerMonitor monitor;
+  QSignalSpy completed(&monitor, &PowerMonitor::probeCompleted);
+
+  // The second event arrives while the first probe is still running and
+  // must not be lost
+  monitor.handleUevent(added);
+  QVERIFY(monitor.isProbing());
+  monitor.handleUevent(drmAdded);
+
+  QTRY_COMPARE_WITH_TIMEOUT(completed.count(), 2, 10000);
+  QTRY_VERIFY(!monitor.isProbing());
+
+  // Nothing else was pending
+  QTest::qWait(100);
+  QCOMPARE(completed.count(), 2);
+}
+
+QTEST_GUILESS_MAIN(UeventMonitorTest)
+
+#include "ueventmonitortest.moc"
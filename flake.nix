@@ -96,6 +96,7 @@
                 serviceConfig = {
                   Type = "simple";
                   ExecStart = "${cfg.package}/bin/uncrashd";
+                  ExecReload = "${pkgs.coreutils}/bin/kill -HUP $MAINPID";
                   Restart = "on-failure";
                   RestartSec = "5s";
 
@@ -113,6 +114,11 @@
                     "/sys/devices/system/cpu"
                   ];
 
+                  # Throttle totals of the current boot survive daemon
+                  # restarts
+                  RuntimeDirectory = "uncrash";
+                  RuntimeDirectoryPreserve = true;
+
                   # Logging
                   StandardOutput = "journal";
                   StandardError = "journal";
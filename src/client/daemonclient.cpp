@@ -34,54 +34,10 @@ void DaemonClient::connectToService() {
     return;
   }
 
-  // Connect to daemon signals
-  bus.connect("org.uncrash.Daemon", "/org/uncrash/Daemon", "org.uncrash.Daemon",
-              "GpuPowerChanged", this, SLOT(onGpuPowerChanged(double)));
-  bus.connect("org.uncrash.Daemon", "/org/uncrash/Daemon", "org.uncrash.Daemon",
-              "GpuPowerThresholdChanged", this,
-              SLOT(onGpuPowerThresholdChanged(double)));
-  bus.connect("org.uncrash.Daemon", "/org/uncrash/Daemon", "org.uncrash.Daemon",
-              "CurrentMaxFrequencyChanged", this,
-              SLOT(onCurrentMaxFrequencyChanged(double)));
-  bus.connect("org.uncrash.Daemon", "/org/uncrash/Daemon", "org.uncrash.Daemon",
-              "CurrentFrequencyChanged", this,
-              SLOT(onCurrentFrequencyChanged(double)));
-  bus.connect("org.uncrash.Daemon", "/org/uncrash/Daemon", "org.uncrash.Daemon",
-              "MaxFrequencyChanged", this, SLOT(onMaxFrequencyChanged(double)));
-  bus.connect("org.uncrash.Daemon", "/org/uncrash/Daemon", "org.uncrash.Daemon",
-              "RegulationEnabledChanged", this,
-              SLOT(onRegulationEnabledChanged(bool)));
-  bus.connect("org.uncrash.Daemon", "/org/uncrash/Daemon", "org.uncrash.Daemon",
-              "AutoProtectionChanged", this,
-              SLOT(onAutoProtectionChanged(bool)));
-  bus.connect("org.uncrash.Daemon", "/org/uncrash/Daemon", "org.uncrash.Daemon",
-              "CooldownSecondsChanged", this,
-              SLOT(onCooldownSecondsChanged(int)));
-  bus.connect("org.uncrash.Daemon", "/org/uncrash/Daemon", "org.uncrash.Daemon",
-              "ThresholdExceededChanged", this,
-              SLOT(onThresholdExceededChanged(bool)));
-  bus.connect("org.uncrash.Daemon", "/org/uncrash/Daemon", "org.uncrash.Daemon",
-              "CpuLimitAppliedChanged", this,
-              SLOT(onCpuLimitAppliedChanged(bool)));
-
-  // Connect to temperature signals
-  bus.connect("org.uncrash.Daemon", "/org/uncrash/Daemon", "org.uncrash.Daemon",
-              "GpuTemperatureChanged", this,
-              SLOT(onGpuTemperatureChanged(double)));
-  bus.connect("org.uncrash.Daemon", "/org/uncrash/Daemon", "org.uncrash.Daemon",
-              "GpuFanSpeedChanged", this, SLOT(onGpuFanSpeedChanged(int)));
-  bus.connect("org.uncrash.Daemon", "/org/uncrash/Daemon", "org.uncrash.Daemon",
-              "CpuTemperatureChanged", this,
-              SLOT(onCpuTemperatureChanged(double)));
-  bus.connect("org.uncrash.Daemon", "/org/uncrash/Daemon", "org.uncrash.Daemon",
-              "CpuFanSpeedChanged", this, SLOT(onCpuFanSpeedChanged(int)));
-  bus.connect("org.uncrash.Daemon", "/org/uncrash/Daemon", "org.uncrash.Daemon",
-              "MotherboardTemperatureChanged", this,
-              SLOT(onMotherboardTemperatureChanged(double)));
-  bus.connect("org.uncrash.Daemon", "/org/uncrash/Daemon", "org.uncrash.Daemon",
-              "GpuVendorChanged", this, SLOT(onGpuVendorChanged(QString)));
-  bus.connect("org.uncrash.Daemon", "/org/uncrash/Daemon", "org.uncrash.Daemon",
-              "GpuNameChanged", this, SLOT(onGpuNameChanged(QString)));
+  // The daemon batches its property changes per sampling tick
+  bus.connect("org.uncrash.Daemon", "/org/uncrash/Daemon",
+              "org.freedesktop.DBus.Properties", "PropertiesChanged", this,
+              SLOT(onPropertiesChanged(QString, QVariantMap, QStringList)));
 
   updateConnectionStatus(true);
   refreshStatus();
@@ -220,54 +176,71 @@ void DaemonClient::refreshStatus() {
   }
 }
 
-void DaemonClient::onGpuPowerChanged(double power) {
-  m_gpuPower = power;
-  emit gpuPowerChanged();
-}
-
-void DaemonClient::onGpuPowerThresholdChanged(double threshold) {
-  m_gpuPowerThreshold = threshold;
-  emit gpuPowerThresholdChanged();
-}
-
-void DaemonClient::onCurrentMaxFrequencyChanged(double frequency) {
-  m_currentMaxFrequency = frequency;
-  emit currentMaxFrequencyChanged();
-}
-
-void DaemonClient::onCurrentFrequencyChanged(double frequency) {
-  m_currentFrequency = frequency;
-  emit currentFrequencyChanged();
-}
-
-void DaemonClient::onMaxFrequencyChanged(double frequency) {
-  m_maxFrequency = frequency;
-  emit maxFrequencyChanged();
-}
-
-void DaemonClient::onRegulationEnabledChanged(bool enabled) {
-  m_regulationEnabled = enabled;
-  emit regulationEnabledChanged();
-}
-
-void DaemonClient::onAutoProtectionChanged(bool enabled) {
-  m_autoProtection = enabled;
-  emit autoProtectionChanged();
-}
-
-void DaemonClient::onCooldownSecondsChanged(int seconds) {
-  m_cooldownSeconds = seconds;
-  emit cooldownSecondsChanged();
-}
-
-void DaemonClient::onThresholdExceededChanged(bool exceeded) {
-  m_thresholdExceeded = exceeded;
-  emit thresholdExceededChanged();
-}
+void DaemonClient::onPropertiesChanged(const QString &interface,
+                                       const QVariantMap &changed,
+                                       const QStringList & /*invalidated*/) {
+  if (interface != "org.uncrash.Daemon") {
+    return;
+  }
 
-void DaemonClient::onCpuLimitAppliedChanged(bool applied) {
-  m_cpuLimitApplied = applied;
-  emit cpuLimitAppliedChanged();
+  // Only the properties that changed are in the map
+  for (auto it = changed.begin(); it != changed.end(); ++it) {
+    const QString &name = it.key();
+    const QVariant &value = it.value();
+
+    if (name == "GpuPower") {
+      m_gpuPower = value.toDouble();
+      emit gpuPowerChanged();
+    } else if (name == "GpuPowerThreshold") {
+      m_gpuPowerThreshold = value.toDouble();
+      emit gpuPowerThresholdChanged();
+    } else if (name == "CurrentMaxFrequency") {
+      m_currentMaxFrequency = value.toDouble();
+      emit currentMaxFrequencyChanged();
+    } else if (name == "CurrentFrequency") {
+      m_currentFrequency = value.toDouble();
+      emit currentFrequencyChanged();
+    } else if (name == "MaxFrequency") {
+      m_maxFrequency = value.toDouble();
+      emit maxFrequencyChanged();
+    } else if (name == "RegulationEnabled") {
+      m_regulationEnabled = value.toBool();
+      emit regulationEnabledChanged();
+    } else if (name == "AutoProtection") {
+      m_autoProtection = value.toBool();
+      emit autoProtectionChanged();
+    } else if (name == "CooldownSeconds") {
+      m_cooldownSeconds = value.toInt();
+      emit cooldownSecondsChanged();
+    } else if (name == "ThresholdExceeded") {
+      m_thresholdExceeded = value.toBool();
+      emit thresholdExceededChanged();
+    } else if (name == "CpuLimitApplied") {
+      m_cpuLimitApplied = value.toBool();
+      emit cpuLimitAppliedChanged();
+    } else if (name == "GpuTemperature") {
+      m_gpuTemperature = value.toDouble();
+      emit gpuTemperatureChanged();
+    } else if (name == "GpuFanSpeed") {
+      m_gpuFanSpeed = value.toInt();
+      emit gpuFanSpeedChanged();
+    } else if (name == "CpuTemperature") {
+      m_cpuTemperature = value.toDouble();
+      emit cpuTemperatureChanged();
+    } else if (name == "CpuFanSpeed") {
+      m_cpuFanSpeed = value.toInt();
+      emit cpuFanSpeedChanged();
+    } else if (name == "MotherboardTemperature") {
+      m_motherboardTemperature = value.toDouble();
+      emit motherboardTemperatureChanged();
+    } else if (name == "GpuVendor") {
+      m_gpuVendor = value.toString();
+      emit gpuVendorChanged();
+    } else if (name == "GpuName") {
+      m_gpuName = value.toString();
+      emit gpuNameChanged();
+    }
+  }
 }
 
 void DaemonClient::onServiceOwnerChanged(const QString &name,
@@ -283,53 +256,3 @@ void DaemonClient::onServiceOwnerChanged(const QString &name,
     }
   }
 }
-
-// Temperature slot implementations
-void DaemonClient::onGpuTemperatureChanged(double temperature) {
-  if (m_gpuTemperature != temperature) {
-    m_gpuTemperature = temperature;
-    emit gpuTemperatureChanged();
-  }
-}
-
-void DaemonClient::onGpuFanSpeedChanged(int speed) {
-  if (m_gpuFanSpeed != speed) {
-    m_gpuFanSpeed = speed;
-    emit gpuFanSpeedChanged();
-  }
-}
-
-void DaemonClient::onCpuTemperatureChanged(double temperature) {
-  if (m_cpuTemperature != temperature) {
-    m_cpuTemperature = temperature;
-    emit cpuTemperatureChanged();
-  }
-}
-
-void DaemonClient::onCpuFanSpeedChanged(int speed) {
-  if (m_cpuFanSpeed != speed) {
-    m_cpuFanSpeed = speed;
-    emit cpuFanSpeedChanged();
-  }
-}
-
-void DaemonClient::onMotherboardTemperatureChanged(double temperature) {
-  if (m_motherboardTemperature != temperature) {
-    m_motherboardTemperature = temperature;
-    emit motherboardTemperatureChanged();
-  }
-}
-
-void DaemonClient::onGpuVendorChanged(const QString &vendor) {
-  if (m_gpuVendor != vendor) {
-    m_gpuVendor = vendor;
-    emit gpuVendorChanged();
-  }
-}
-
-void DaemonClient::onGpuNameChanged(const QString &name) {
-  if (m_gpuName != name) {
-    m_gpuName = name;
-    emit gpuNameChanged();
-  }
-}
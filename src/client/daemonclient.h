@@ -3,6 +3,8 @@
 #include <QDBusAbstractInterface>
 #include <QDBusConnection>
 #include <QObject>
+#include <QStringList>
+#include <QVariantMap>
 
 class DaemonClient : public QObject {
   Q_OBJECT
@@ -100,26 +102,11 @@ signals:
   void gpuNameChanged();
 
 private slots:
-  void onGpuPowerChanged(double power);
-  void onGpuPowerThresholdChanged(double threshold);
-  void onCurrentMaxFrequencyChanged(double frequency);
-  void onCurrentFrequencyChanged(double frequency);
-  void onMaxFrequencyChanged(double frequency);
-  void onRegulationEnabledChanged(bool enabled);
-  void onAutoProtectionChanged(bool enabled);
-  void onCooldownSecondsChanged(int seconds);
-  void onThresholdExceededChanged(bool exceeded);
-  void onCpuLimitAppliedChanged(bool applied);
+  void onPropertiesChanged(const QString &interface,
+                           const QVariantMap &changed,
+                           const QStringList &invalidated);
   void onServiceOwnerChanged(const QString &name, const QString &oldOwner,
                              const QString &newOwner);
-  // Temperature slots
-  void onGpuTemperatureChanged(double temperature);
-  void onGpuFanSpeedChanged(int speed);
-  void onCpuTemperatureChanged(double temperature);
-  void onCpuFanSpeedChanged(int speed);
-  void onMotherboardTemperatureChanged(double temperature);
-  void onGpuVendorChanged(const QString &vendor);
-  void onGpuNameChanged(const QString &name);
 
 private:
   void connectToService();
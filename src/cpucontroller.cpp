@@ -1,19 +1,51 @@
 #include "cpucontroller.h"
+#include <QDateTime>
 #include <QDebug>
 #include <QDir>
 #include <QFile>
 #include <QTextStream>
-#include <QTimer>
+#include <algorithm>
+#include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+const QString kCpuPath = "/sys/devices/system/cpu";
+const QString kCpufreqPath = "/sys/devices/system/cpu/cpufreq";
+
+// Back off when fighting another tool over a policy, the backoff is
+// forgotten once the policy kept our limit for the maximum interval
+constexpr qint64 kMinReassertBackoffMs = 1000;
+constexpr qint64 kMaxReassertBackoffMs = 60000;
+
+// Adaptive ceiling: above this PSI share demand exceeds what the CPUs
+// deliver and any headroom would be used, so the configured depth is kept.
+// Ceilings move in 100 MHz steps, so noise does not rewrite the policies
+// every tick. They are only raised after a few samples of lower demand and
+// by a bounded step per sample. A rise in demand lowers them right away to
+// the new target, but only past a margin, so utilization noise at a steady
+// load does not saw-tooth the ceiling.
+constexpr double kSaturatedPressure = 0.10;
+constexpr double kFullLoadUtilization = 0.95;
+constexpr double kMinUtilization = 0.05;
+constexpr qint64 kCeilingStepKHz = 100000;
+constexpr int kStepUpSamples = 3;
+constexpr double kMaxStepUp = 0.3; // GHz per sample
+constexpr double kStepDownMargin = 0.05;
+} // namespace
 
 CpuController::CpuController(QObject *parent) : QObject(parent) {
+  m_clock.start();
+  m_onlineCpus = readOnlineCpus();
+  refreshPolicies();
   m_currentMaxFrequency = readCurrentMaxFrequency();
   m_currentFrequency = readCurrentFrequency();
+}
 
-  // Set up timer to periodically update current frequency
-  m_updateTimer = new QTimer(this);
-  connect(m_updateTimer, &QTimer::timeout, this,
-          &CpuController::updateCurrentFrequency);
-  m_updateTimer->start(2000); // Update every 2 seconds
+CpuController::~CpuController() {
+  for (Policy &policy : m_policies) {
+    closePolicy(policy);
+  }
 }
 
 void CpuController::setMaxFrequency(double frequency) {
@@ -24,7 +56,7 @@ void CpuController::setMaxFrequency(double frequency) {
   emit maxFrequencyChanged();
 
   // If a limit is currently applied, update it to the new frequency
-  if (m_cpuLimitApplied) {
+  if (limitRequested()) {
     applyFrequencyLimit();
   }
 }
@@ -43,81 +75,211 @@ void CpuController::setRegulationEnabled(bool enabled) {
   }
 }
 
+void CpuController::setAdaptiveCeiling(bool enabled) {
+  if (m_adaptiveCeiling == enabled)
+    return;
+
+  m_adaptiveCeiling = enabled;
+  emit adaptiveCeilingChanged();
+
+  // Go back to the configured depth right away, or adapt from there
+  if (limitRequested()) {
+    applyFrequencyLimit();
+  }
+}
+
 void CpuController::applyFrequencyLimit() {
   if (!m_regulationEnabled)
     return;
 
-  bool success = setCpuMaxFrequency(m_maxFrequency);
+  if (m_batchDepth > 0) {
+    m_batchApply = true;
+    m_batchPending = true;
+    return;
+  }
+
+  qint64 previousLimitKHz = m_desiredLimitKHz;
+  m_desiredLimitKHz = static_cast<qint64>(m_maxFrequency * 1000000);
+
+  bool success = writePolicies();
   if (success) {
     qDebug() << "Applied CPU frequency limit:" << m_maxFrequency << "GHz";
     m_currentMaxFrequency = readCurrentMaxFrequency();
     emit currentMaxFrequencyChanged();
 
+    // Engage at the configured depth, an adaptive ceiling is only raised
+    // once the demand under the limit was measured
+    m_demand.reset();
+    m_lowDemandSamples = 0;
+    m_selectedCeiling = m_maxFrequency;
+    m_ceilingReason = "configured";
+    emit selectedCeilingChanged();
+
     if (!m_cpuLimitApplied) {
       m_cpuLimitApplied = true;
       emit cpuLimitAppliedChanged();
     }
   } else {
+    m_desiredLimitKHz = previousLimitKHz;
     qWarning() << "Failed to apply CPU frequency limit";
   }
 }
 
 void CpuController::removeFrequencyLimit() {
-  // Set to a high value to effectively remove the limit
-  // This will allow the CPU to run at its maximum frequency
-  bool success = setCpuMaxFrequency(99.0); // 99 GHz (effectively unlimited)
+  if (m_batchDepth > 0) {
+    m_batchApply = false;
+    m_batchPending = true;
+    return;
+  }
+
+  // Every policy goes back to its hardware maximum
+  qint64 previousLimitKHz = m_desiredLimitKHz;
+  m_desiredLimitKHz = 0;
+
+  bool success = writePolicies();
   if (success) {
     qDebug() << "Removed CPU frequency limit";
     m_currentMaxFrequency = readCurrentMaxFrequency();
     emit currentMaxFrequencyChanged();
 
+    m_selectedCeiling = 0.0;
+    m_ceilingReason = "none";
+    emit selectedCeilingChanged();
+
     if (m_cpuLimitApplied) {
       m_cpuLimitApplied = false;
       emit cpuLimitAppliedChanged();
     }
   } else {
+    m_desiredLimitKHz = previousLimitKHz;
     qWarning() << "Failed to remove CPU frequency limit";
   }
 }
 
-bool CpuController::setCpuMaxFrequency(double frequencyGHz) {
-  // Convert GHz to KHz for sysfs
-  qint64 frequencyKHz = static_cast<qint64>(frequencyGHz * 1000000);
+void CpuController::beginBatch() { m_batchDepth++; }
+
+bool CpuController::limitRequested() const {
+  // Inside a batch the last deferred request decides, the applied state is
+  // only updated by endBatch()
+  return m_batchPending ? m_batchApply : m_cpuLimitApplied;
+}
+
+void CpuController::endBatch() {
+  if (m_batchDepth == 0 || --m_batchDepth > 0 || !m_batchPending)
+    return;
+
+  m_batchPending = false;
+  if (m_batchApply) {
+    applyFrequencyLimit();
+  } else {
+    removeFrequencyLimit();
+  }
+}
+
+void CpuController::handleUevent(const Uevent &event) {
+  if (event.subsystem != "cpu")
+    return;
 
-  // Try to write directly to sysfs files (works when running as root)
-  QDir cpuDir("/sys/devices/system/cpu");
-  QStringList cpuDirs = cpuDir.entryList(QStringList() << "cpu*", QDir::Dirs);
+  if (event.action != "online" && event.action != "offline" &&
+      event.action != "add" && event.action != "remove") {
+    return;
+  }
+
+  m_onlineCpus = readOnlineCpus();
+  syncPolicies();
+}
+
+QStringList CpuController::refreshPolicies() {
+  QDir cpufreqDir(kCpufreqPath);
+  const QStringList names =
+      cpufreqDir.entryList(QStringList() << "policy*", QDir::Dirs);
+
+  // Policies only disappear together with their cpufreq driver
+  for (auto it = m_policies.begin(); it != m_policies.end();) {
+    if (names.contains(it.key())) {
+      ++it;
+    } else {
+      closePolicy(it.value());
+      it = m_policies.erase(it);
+    }
+  }
+
+  QStringList activated;
+  for (const QString &name : names) {
+    Policy &policy = m_policies[name];
+    if (policy.path.isEmpty()) {
+      policy.path = cpufreqDir.filePath(name);
+    }
+
+    if (policy.hardwareMaxKHz <= 0) {
+      policy.hardwareMaxKHz =
+          readSysfsString(policy.path + "/cpuinfo_max_freq").toLongLong();
+    }
+
+    // affected_cpus only lists the online CPUs of the policy, the kernel
+    // rejects limit writes while it is empty
+    bool wasActive = policy.active;
+    policy.active = !readSysfsString(policy.path + "/affected_cpus").isEmpty();
+    if (policy.active && !wasActive) {
+      activated.append(name);
+    }
+  }
+
+  return activated;
+}
+
+void CpuController::syncPolicies() {
+  const QStringList activated = refreshPolicies();
+
+  int reapplied = 0;
+  for (const QString &name : activated) {
+    Policy &policy = m_policies[name];
+
+    // A policy coming back online keeps whatever limit it had when it went
+    // down, or its hardware maximum if it is new
+    if (m_desiredLimitKHz <= 0 && !policy.stale) {
+      continue;
+    }
+
+    if (writePolicy(policy)) {
+      reapplied++;
+    }
+  }
+
+  if (reapplied > 0) {
+    qInfo() << "Re-applied CPU frequency limit to" << reapplied
+            << "onlined policies";
+    updateCurrentFrequency();
+  }
+}
+
+qint64 CpuController::desiredMaxKHz(const Policy &policy) const {
+  if (m_desiredLimitKHz > 0) {
+    return policy.hardwareMaxKHz > 0
+               ? std::min(m_desiredLimitKHz, policy.hardwareMaxKHz)
+               : m_desiredLimitKHz;
+  }
+
+  // Unknown hardware maximum, a high value is clamped by the kernel
+  return policy.hardwareMaxKHz > 0 ? policy.hardwareMaxKHz : 99000000;
+}
+
+bool CpuController::writePolicies() {
+  refreshPolicies();
 
-  bool anySuccess = false;
   int successCount = 0;
   int totalCount = 0;
 
-  for (const QString &cpuDirName : cpuDirs) {
-    QString freqPath =
-        QString("/sys/devices/system/cpu/%1/cpufreq/scaling_max_freq")
-            .arg(cpuDirName);
-    QFile file(freqPath);
-
-    if (!file.exists()) {
-      continue; // Skip if cpufreq not available for this CPU
+  for (Policy &policy : m_policies) {
+    // Written as soon as one of its CPUs comes back online
+    if (!policy.active) {
+      policy.stale = true;
+      continue;
     }
 
     totalCount++;
-
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-      QTextStream out(&file);
-      out << frequencyKHz;
-      file.close();
-
-      if (file.error() == QFile::NoError) {
-        anySuccess = true;
-        successCount++;
-      } else {
-        qWarning() << "Error writing to" << freqPath << ":"
-                   << file.errorString();
-      }
-    } else {
-      qWarning() << "Failed to open" << freqPath << ":" << file.errorString();
+    if (writePolicy(policy)) {
+      successCount++;
     }
   }
 
@@ -126,34 +288,224 @@ bool CpuController::setCpuMaxFrequency(double frequencyGHz) {
     return false;
   }
 
-  if (anySuccess) {
+  if (successCount > 0) {
     qDebug() << "Successfully set frequency on" << successCount << "of"
-             << totalCount << "CPUs";
+             << totalCount << "CPU policies";
     return true;
   }
 
-  qWarning() << "Failed to set frequency on any CPU";
+  qWarning() << "Failed to set frequency on any CPU policy";
   return false;
 }
 
-double CpuController::readCurrentMaxFrequency() {
-  // Read from the first CPU core
-  QString maxFreqPath = "/sys/devices/system/cpu/cpu0/cpufreq/scaling_max_freq";
-  QFile file(maxFreqPath);
+bool CpuController::writePolicy(Policy &policy) {
+  QString freqPath = policy.path + "/scaling_max_freq";
+  QFile file(freqPath);
 
-  if (file.open(QIODevice::ReadOnly)) {
-    QString freqStr = QString::fromUtf8(file.readAll()).trimmed();
-    bool ok;
-    qint64 frequencyKHz = freqStr.toLongLong(&ok);
-    if (ok) {
-      // Convert from KHz to GHz
-      return frequencyKHz / 1000000.0;
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    qWarning() << "Failed to open" << freqPath << ":" << file.errorString();
+    policy.stale = true;
+    return false;
+  }
+
+  QTextStream out(&file);
+  out << desiredMaxKHz(policy);
+  file.close();
+
+  if (file.error() != QFile::NoError) {
+    qWarning() << "Error writing to" << freqPath << ":" << file.errorString();
+    policy.stale = true;
+    return false;
+  }
+
+  policy.stale = false;
+  policy.expectedKHz = readPolicyMaxKHz(policy);
+  return true;
+}
+
+void CpuController::reconcilePolicies() {
+  // Only a limit applied by us is defended
+  if (!m_cpuLimitApplied || m_desiredLimitKHz <= 0)
+    return;
+
+  qint64 now = m_clock.elapsed();
+  bool changed = false;
+
+  for (auto it = m_policies.begin(); it != m_policies.end(); ++it) {
+    Policy &policy = it.value();
+    if (!policy.active || policy.expectedKHz <= 0) {
+      continue;
     }
+
+    qint64 valueKHz = readPolicyMaxKHz(policy);
+    if (valueKHz <= 0) {
+      continue;
+    }
+
+    if (valueKHz == policy.expectedKHz) {
+      policy.drifted = false;
+      if (policy.backoffMs > 0 &&
+          now - policy.lastReassertMs >= kMaxReassertBackoffMs) {
+        policy.backoffMs = 0;
+      }
+      continue;
+    }
+
+    if (!policy.drifted) {
+      policy.drifted = true;
+      policy.externalChanges++;
+      policy.lastExternalKHz = valueKHz;
+      policy.lastExternalChange = QDateTime::currentMSecsSinceEpoch();
+      m_externalLimitChanges++;
+      changed = true;
+
+      qWarning() << "CPU frequency limit of" << it.key()
+                 << "was changed externally to" << valueKHz / 1000000.0
+                 << "GHz";
+    }
+
+    if (policy.backoffMs > 0 &&
+        now - policy.lastReassertMs < policy.backoffMs) {
+      continue;
+    }
+
+    if (writePolicy(policy)) {
+      // Count the next overwrite again
+      policy.drifted = false;
+    }
+
+    policy.backoffMs =
+        policy.backoffMs > 0
+            ? std::min(policy.backoffMs * 2, kMaxReassertBackoffMs)
+            : kMinReassertBackoffMs;
+    policy.lastReassertMs = now;
   }
 
-  return 0.0;
+  if (changed) {
+    emit externalLimitChangesChanged();
+  }
+}
+
+QVariantMap CpuController::limitDrift() const {
+  QVariantMap drift;
+  for (auto it = m_policies.cbegin(); it != m_policies.cend(); ++it) {
+    const Policy &policy = it.value();
+
+    QVariantMap entry;
+    entry["externalChanges"] = policy.externalChanges;
+    entry["lastExternalFrequency"] = policy.lastExternalKHz / 1000000.0;
+    entry["lastExternalChange"] = policy.lastExternalChange;
+    drift[it.key()] = entry;
+  }
+  return drift;
+}
+
+void CpuController::updateCeiling() {
+  if (!m_cpuLimitApplied || !m_adaptiveCeiling)
+    return;
+
+  double utilization;
+  double pressure;
+  if (!m_demand.sample(&utilization, &pressure))
+    return;
+
+  // Dynamic power scales with about f³ (voltage follows frequency) and with
+  // the busy share, so maxFrequency at full load draws as much as
+  // maxFrequency / cbrt(u) at utilization u
+  if (pressure >= kSaturatedPressure) {
+    m_lowDemandSamples = 0;
+    selectCeiling(m_maxFrequency, "cpu-pressure");
+    return;
+  }
+  if (utilization >= kFullLoadUtilization) {
+    m_lowDemandSamples = 0;
+    selectCeiling(m_maxFrequency, "full-load");
+    return;
+  }
+
+  double target =
+      m_maxFrequency / std::cbrt(std::max(utilization, kMinUtilization));
+
+  // The raised ceiling only keeps the power bound at the demand it was
+  // chosen for. When demand rises it follows right away instead of after
+  // PSI has built up over avg10, within the margin it is held.
+  if (target < m_selectedCeiling) {
+    m_lowDemandSamples = 0;
+    double margin = std::max(kCeilingStepKHz / 1000000.0,
+                             m_selectedCeiling * kStepDownMargin);
+    if (target < m_selectedCeiling - margin) {
+      selectCeiling(target, "utilization");
+    }
+    return;
+  }
+
+  if (++m_lowDemandSamples < kStepUpSamples)
+    return;
+
+  selectCeiling(std::min(target, m_selectedCeiling + kMaxStepUp),
+                "utilization");
+}
+
+void CpuController::selectCeiling(double ceiling, const QString &reason) {
+  double hardwareMax = hardwareMaxFrequency();
+  if (hardwareMax > 0) {
+    ceiling = std::min(ceiling, hardwareMax);
+  }
+  ceiling = std::max(ceiling, m_maxFrequency);
+
+  qint64 ceilingKHz = static_cast<qint64>(ceiling * 1000000);
+  ceilingKHz -= ceilingKHz % kCeilingStepKHz;
+  ceilingKHz = std::max(ceilingKHz, qint64(m_maxFrequency * 1000000));
+
+  if (ceilingKHz == m_desiredLimitKHz && reason == m_ceilingReason)
+    return;
+
+  if (ceilingKHz != m_desiredLimitKHz) {
+    qint64 previousLimitKHz = m_desiredLimitKHz;
+    m_desiredLimitKHz = ceilingKHz;
+    if (!writePolicies()) {
+      m_desiredLimitKHz = previousLimitKHz;
+      qWarning() << "Failed to apply adaptive CPU frequency ceiling";
+      return;
+    }
+
+    qDebug() << "Adaptive CPU frequency ceiling:" << ceilingKHz / 1000000.0
+             << "GHz (" << reason << ")";
+    m_currentMaxFrequency = readCurrentMaxFrequency();
+    emit currentMaxFrequencyChanged();
+  }
+
+  m_selectedCeiling = ceilingKHz / 1000000.0;
+  m_ceilingReason = reason;
+  emit selectedCeilingChanged();
+}
+
+double CpuController::hardwareMaxFrequency() const {
+  qint64 maxFrequencyKHz = 0;
+  for (const Policy &policy : m_policies) {
+    if (policy.active) {
+      maxFrequencyKHz = std::max(maxFrequencyKHz, policy.hardwareMaxKHz);
+    }
+  }
+
+  return maxFrequencyKHz / 1000000.0;
 }
 
+double CpuController::readCurrentMaxFrequency() {
+  // The highest ceiling of all online policies, so a policy that escaped the
+  // limit is visible
+  qint64 maxFrequencyKHz = 0;
+  for (Policy &policy : m_policies) {
+    if (!policy.active) {
+      continue;
+    }
+
+    maxFrequencyKHz = std::max(maxFrequencyKHz, readPolicyMaxKHz(policy));
+  }
+
+  // Convert from KHz to GHz
+  return maxFrequencyKHz / 1000000.0;
+}
 double CpuController::readCurrentFrequency() {
   // Read from the first CPU core - the actual current frequency
   QString curFreqPath = "/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq";
@@ -173,6 +525,13 @@ double CpuController::readCurrentFrequency() {
 }
 
 void CpuController::updateCurrentFrequency() {
+  // Catches hotplug within one tick even if its uevent got lost
+  QString onlineCpus = readOnlineCpus();
+  if (onlineCpus != m_onlineCpus) {
+    m_onlineCpus = onlineCpus;
+    syncPolicies();
+  }
+
   double newFrequency = readCurrentMaxFrequency();
   if (!qFuzzyCompare(m_currentMaxFrequency, newFrequency)) {
     m_currentMaxFrequency = newFrequency;
@@ -185,3 +544,43 @@ void CpuController::updateCurrentFrequency() {
     emit currentFrequencyChanged();
   }
 }
+
+qint64 CpuController::readPolicyMaxKHz(Policy &policy) {
+  if (policy.maxFreqFd < 0) {
+    QByteArray path = (policy.path + "/scaling_max_freq").toLocal8Bit();
+    policy.maxFreqFd = ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+    if (policy.maxFreqFd < 0) {
+      return 0;
+    }
+  }
+
+  // sysfs regenerates the value on every read from offset 0
+  char buffer[32];
+  ssize_t length = ::pread(policy.maxFreqFd, buffer, sizeof(buffer) - 1, 0);
+  if (length <= 0) {
+    return 0;
+  }
+
+  buffer[length] = '\0';
+  return QByteArray(buffer).trimmed().toLongLong();
+}
+
+void CpuController::closePolicy(Policy &policy) {
+  if (policy.maxFreqFd >= 0) {
+    ::close(policy.maxFreqFd);
+    policy.maxFreqFd = -1;
+  }
+}
+
+QString CpuController::readOnlineCpus() {
+  return readSysfsString(kCpuPath + "/online");
+}
+
+QString CpuController::readSysfsString(const QString &path) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return QString();
+  }
+
+  return QString::fromUtf8(file.readAll()).trimmed();
+}
@@ -1,7 +1,12 @@
 #pragma once
 
+#include "cpudemand.h"
+#include "ueventmonitor.h"
+#include <QElapsedTimer>
+#include <QMap>
 #include <QObject>
-#include <QTimer>
+#include <QStringList>
+#include <QVariantMap>
 
 class CpuController : public QObject {
   Q_OBJECT
@@ -15,15 +20,44 @@ class CpuController : public QObject {
                  setRegulationEnabled NOTIFY regulationEnabledChanged)
   Q_PROPERTY(
       bool cpuLimitApplied READ cpuLimitApplied NOTIFY cpuLimitAppliedChanged)
+  Q_PROPERTY(int externalLimitChanges READ externalLimitChanges NOTIFY
+                 externalLimitChangesChanged)
+  Q_PROPERTY(bool adaptiveCeiling READ adaptiveCeiling WRITE
+                 setAdaptiveCeiling NOTIFY adaptiveCeilingChanged)
+  Q_PROPERTY(
+      double selectedCeiling READ selectedCeiling NOTIFY selectedCeilingChanged)
+  Q_PROPERTY(
+      QString ceilingReason READ ceilingReason NOTIFY selectedCeilingChanged)
 
 public:
   explicit CpuController(QObject *parent = nullptr);
+  ~CpuController() override;
 
   double maxFrequency() const { return m_maxFrequency; }
   double currentMaxFrequency() const { return m_currentMaxFrequency; }
   double currentFrequency() const { return m_currentFrequency; }
   bool regulationEnabled() const { return m_regulationEnabled; }
   bool cpuLimitApplied() const { return m_cpuLimitApplied; }
+  int externalLimitChanges() const { return m_externalLimitChanges; }
+
+  // With an adaptive ceiling the applied limit is raised above
+  // maxFrequency while the CPUs are lightly loaded, as far as the power
+  // reduction of maxFrequency at full load is still achieved
+  bool adaptiveCeiling() const { return m_adaptiveCeiling; }
+  void setAdaptiveCeiling(bool enabled);
+
+  // Applied ceiling in GHz (0 without a limit) and why it was chosen:
+  // "none", "configured", "full-load", "cpu-pressure" or "utilization"
+  double selectedCeiling() const { return m_selectedCeiling; }
+  QString ceilingReason() const { return m_ceilingReason; }
+
+  // Highest cpuinfo_max_freq of all online policies in GHz, the ceiling
+  // removing the limit restores
+  double hardwareMaxFrequency() const;
+
+  // Per policy: externalChanges, lastExternalFrequency (GHz) and
+  // lastExternalChange (ms since epoch)
+  QVariantMap limitDrift() const;
 
   void setMaxFrequency(double frequency);
   void setRegulationEnabled(bool enabled);
@@ -31,23 +65,92 @@ public:
   void applyFrequencyLimit();
   void removeFrequencyLimit();
 
+  // Defers applying and removing the limit until the outermost endBatch(),
+  // so changing several settings at once writes the policies only once,
+  // with the final limit
+  void beginBatch();
+  void endBatch();
+
+  // Re-applies the desired limit to policies whose CPUs came back online
+  void handleUevent(const Uevent &event);
+
+public slots:
+  // Called by the daemon's tick scheduler
+  void updateCurrentFrequency();
+
+  // Re-selects the adaptive ceiling from the CPU demand while the limit
+  // is applied
+  void updateCeiling();
+
+  // Verifies every policy still carries the applied limit and re-asserts
+  // it with exponential backoff where another tool overwrote it
+  void reconcilePolicies();
+
 signals:
   void maxFrequencyChanged();
   void currentMaxFrequencyChanged();
   void currentFrequencyChanged();
   void regulationEnabledChanged();
   void cpuLimitAppliedChanged();
+  void externalLimitChangesChanged();
+  void adaptiveCeilingChanged();
+  void selectedCeilingChanged();
 
 private:
-  bool setCpuMaxFrequency(double frequencyGHz);
+  // One cpufreq policy, shared by all CPUs listed in its related_cpus
+  struct Policy {
+    QString path;              // .../cpufreq/policyN
+    qint64 hardwareMaxKHz = 0; // cpuinfo_max_freq
+    bool active = false;       // At least one of its CPUs is online
+    bool stale = false;        // Missed a limit change while inactive
+    int maxFreqFd = -1;        // scaling_max_freq, kept open for re-reads
+
+    // What the kernel made of our last write, it may round or clamp
+    qint64 expectedKHz = 0;
+
+    // Ownership reconciliation
+    bool drifted = false;
+    int externalChanges = 0;
+    qint64 lastExternalKHz = 0;
+    qint64 lastExternalChange = 0; // ms since epoch
+    qint64 backoffMs = 0;
+    qint64 lastReassertMs = 0;
+  };
+
+  QStringList refreshPolicies();
+  void selectCeiling(double ceiling, const QString &reason);
+  bool writePolicies();
+  bool writePolicy(Policy &policy);
+  qint64 desiredMaxKHz(const Policy &policy) const;
+  void syncPolicies();
+  bool limitRequested() const;
   double readCurrentMaxFrequency();
   double readCurrentFrequency();
-  void updateCurrentFrequency();
+
+  static qint64 readPolicyMaxKHz(Policy &policy);
+  static void closePolicy(Policy &policy);
+  static QString readOnlineCpus();
+  static QString readSysfsString(const QString &path);
 
   double m_maxFrequency = 3.5; // Default: 3.5 GHz
   double m_currentMaxFrequency = 0.0;
   double m_currentFrequency = 0.0;
   bool m_regulationEnabled = true;
   bool m_cpuLimitApplied = false;
-  QTimer *m_updateTimer;
+
+  qint64 m_desiredLimitKHz = 0;     // 0 while no limit is requested
+  QMap<QString, Policy> m_policies; // By policy directory name
+  QString m_onlineCpus;             // Last /sys/devices/system/cpu/online
+  int m_externalLimitChanges = 0;
+  QElapsedTimer m_clock;
+
+  int m_batchDepth = 0;
+  bool m_batchApply = false;   // Last deferred request applies the limit
+  bool m_batchPending = false; // A request was deferred
+
+  bool m_adaptiveCeiling = false;
+  double m_selectedCeiling = 0.0;
+  QString m_ceilingReason = "none";
+  int m_lowDemandSamples = 0; // Samples the ceiling could have been raised
+  CpuDemand m_demand;
 };
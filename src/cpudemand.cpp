@@ -0,0 +1,99 @@
+#include "cpudemand.h"
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+CpuDemand::CpuDemand() {
+  m_statFd = ::open("/proc/stat", O_RDONLY | O_CLOEXEC);
+  m_pressureFd = ::open("/proc/pressure/cpu", O_RDONLY | O_CLOEXEC);
+}
+
+CpuDemand::~CpuDemand() {
+  if (m_statFd >= 0) {
+    ::close(m_statFd);
+  }
+  if (m_pressureFd >= 0) {
+    ::close(m_pressureFd);
+  }
+}
+
+bool CpuDemand::sample(double *utilization, double *pressure) {
+  if (m_statFd < 0) {
+    return false;
+  }
+
+  // The aggregate line comes first, the interrupt counters further down
+  // can be many kilobytes and are not needed
+  char buffer[512];
+  ssize_t length = ::pread(m_statFd, buffer, sizeof(buffer) - 1, 0);
+  if (length <= 0) {
+    return false;
+  }
+  buffer[length] = '\0';
+
+  quint64 busy;
+  quint64 total;
+  if (!parseStat(buffer, &busy, &total)) {
+    return false;
+  }
+
+  bool valid = m_hasBaseline && total > m_lastTotal && busy >= m_lastBusy;
+  if (valid) {
+    *utilization = double(busy - m_lastBusy) / double(total - m_lastTotal);
+    *pressure = readPressure();
+  }
+
+  m_lastBusy = busy;
+  m_lastTotal = total;
+  m_hasBaseline = true;
+  return valid;
+}
+
+bool CpuDemand::parseStat(const char *data, quint64 *busy, quint64 *total) {
+  // "cpu  user nice system idle iowait irq softirq steal guest guest_nice",
+  // guest time is already part of user and nice
+  if (std::strncmp(data, "cpu ", 4) != 0) {
+    return false;
+  }
+
+  const char *position = data + 4;
+  quint64 fields[8] = {};
+  for (quint64 &field : fields) {
+    char *end;
+    field = std::strtoull(position, &end, 10);
+    if (end == position) {
+      return false;
+    }
+    position = end;
+  }
+
+  quint64 idle = fields[3] + fields[4];
+  *total = 0;
+  for (quint64 field : fields) {
+    *total += field;
+  }
+  *busy = *total - idle;
+  return true;
+}
+
+double CpuDemand::readPressure() {
+  if (m_pressureFd < 0) {
+    return 0.0;
+  }
+
+  // "some avg10=12.34 avg60=..." in percent
+  char buffer[256];
+  ssize_t length = ::pread(m_pressureFd, buffer, sizeof(buffer) - 1, 0);
+  if (length <= 0) {
+    return 0.0;
+  }
+  buffer[length] = '\0';
+
+  const char *avg10 = std::strstr(buffer, "avg10=");
+  if (avg10 == nullptr) {
+    return 0.0;
+  }
+
+  return std::strtod(avg10 + 6, nullptr) / 100.0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QtGlobal>
+
+// Samples CPU demand from /proc/stat and /proc/pressure/cpu through files
+// kept open, a sample is two preads
+class CpuDemand {
+public:
+  CpuDemand();
+  ~CpuDemand();
+
+  CpuDemand(const CpuDemand &) = delete;
+  CpuDemand &operator=(const CpuDemand &) = delete;
+
+  // Busy share of all online CPUs since the previous sample and the PSI
+  // "some" avg10 share, both 0 to 1. The first sample after reset() only
+  // sets the baseline and returns false.
+  bool sample(double *utilization, double *pressure);
+  void reset() { m_hasBaseline = false; }
+
+  // Parses the aggregate "cpu" line, the per-core lines below it add up to
+  // it. Idle and iowait count as idle.
+  static bool parseStat(const char *data, quint64 *busy, quint64 *total);
+
+private:
+  double readPressure();
+
+  int m_statFd = -1;
+  int m_pressureFd = -1;
+  quint64 m_lastBusy = 0;
+  quint64 m_lastTotal = 0;
+  bool m_hasBaseline = false;
+};
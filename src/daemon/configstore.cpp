@@ -0,0 +1,119 @@
+#include "configstore.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+// Slider drags in the GUI set a value many times per second
+constexpr int kWriteDelayMs = 1000;
+
+bool syncPath(const QString &path, int flags) {
+  int fd = ::open(QFile::encodeName(path).constData(), flags | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = ::fsync(fd) == 0;
+  ::close(fd);
+  return ok;
+}
+} // namespace
+
+ConfigStore::ConfigStore(const QString &path, QObject *parent)
+    : QObject(parent), m_path(path), m_timer(new QTimer(this)) {
+  m_pool.setMaxThreadCount(1);
+
+  m_timer->setSingleShot(true);
+  m_timer->setInterval(kWriteDelayMs);
+  connect(m_timer, &QTimer::timeout, this, &ConfigStore::startWrite);
+}
+
+ConfigStore::~ConfigStore() { flush(); }
+
+void ConfigStore::save(const QVariantMap &values) {
+  for (auto it = values.begin(); it != values.end(); ++it) {
+    m_pending.insert(it.key(), it.value());
+  }
+  m_hasPending = true;
+
+  // Not restarted, so a long drag still gets written once per interval
+  if (!m_timer->isActive()) {
+    m_timer->start();
+  }
+}
+
+void ConfigStore::flush() {
+  m_timer->stop();
+  startWrite();
+  m_pool.waitForDone();
+}
+
+void ConfigStore::startWrite() {
+  if (!m_hasPending) {
+    return;
+  }
+
+  QString path = m_path;
+  QVariantMap values = m_pending;
+  m_pending.clear();
+  m_hasPending = false;
+
+  m_writing++;
+  m_pool.start([this, path, values]() {
+    if (write(path, values)) {
+      qDebug() << "Settings written to" << path;
+    }
+    m_writing--;
+  });
+}
+
+bool ConfigStore::write(const QString &path, const QVariantMap &values) {
+  QFileInfo info(path);
+  QDir().mkpath(info.absolutePath());
+
+  QString temporaryPath = path + ".tmp";
+  QFile::remove(temporaryPath);
+
+  {
+    QSettings current(path, QSettings::IniFormat);
+    QSettings temporary(temporaryPath, QSettings::IniFormat);
+
+    // Keep keys added by hand or by other versions
+    const QStringList keys = current.allKeys();
+    for (const QString &key : keys) {
+      temporary.setValue(key, current.value(key));
+    }
+    for (auto it = values.begin(); it != values.end(); ++it) {
+      temporary.setValue(it.key(), it.value());
+    }
+
+    temporary.sync();
+    if (temporary.status() != QSettings::NoError) {
+      qWarning() << "Failed to write" << temporaryPath;
+      QFile::remove(temporaryPath);
+      return false;
+    }
+  }
+
+  if (!syncPath(temporaryPath, O_RDONLY)) {
+    qWarning() << "Failed to sync" << temporaryPath << strerror(errno);
+    QFile::remove(temporaryPath);
+    return false;
+  }
+
+  if (::rename(QFile::encodeName(temporaryPath).constData(),
+               QFile::encodeName(path).constData()) != 0) {
+    qWarning() << "Failed to replace" << path << strerror(errno);
+    QFile::remove(temporaryPath);
+    return false;
+  }
+
+  // Make the rename itself durable
+  syncPath(info.absolutePath(), O_RDONLY | O_DIRECTORY);
+  return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVariantMap>
+#include <atomic>
+
+// Write-behind persistence of the daemon settings. save() only records the
+// values, they are written at most once per second on a worker thread, so
+// DBus setters never wait for the disk. Only the saved keys are written,
+// the file keeps its other values as they are on disk at the write.
+//
+// A write goes to a temporary file next to the config, which is fsync()ed
+// and renamed over it, so a crash or power loss leaves either the old or the
+// new file, never a truncated one. Keys the daemon doesn't write are kept.
+class ConfigStore : public QObject {
+  Q_OBJECT
+
+public:
+  explicit ConfigStore(const QString &path, QObject *parent = nullptr);
+  ~ConfigStore() override;
+
+  QString path() const { return m_path; }
+
+  // Values of the General section, or "section/key", merged into the ones
+  // still pending
+  void save(const QVariantMap &values);
+
+  // Writes pending values and waits for all writes, e.g. on shutdown
+  void flush();
+
+  // Values are pending or being written, the file doesn't have them yet
+  bool isBusy() const { return m_hasPending || m_writing > 0; }
+
+private slots:
+  void startWrite();
+
+private:
+  static bool write(const QString &path, const QVariantMap &values);
+
+  QString m_path;
+  QTimer *m_timer;
+  QThreadPool m_pool; // One thread, so writes land in order
+  QVariantMap m_pending;
+  bool m_hasPending = false;
+  std::atomic<int> m_writing{0};
+};
@@ -2,64 +2,245 @@
 #include <QDBusConnection>
 #include <QDBusError>
 #include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRandomGenerator>
+#include <QSet>
 #include <QSettings>
+#include <QThreadPool>
+#include <algorithm>
 
-DaemonService::DaemonService(QObject *parent) : QObject(parent) {
+namespace {
+// One hour at one sample per second
+constexpr int kHistoryIntervalMs = 1000;
+constexpr int kHistorySamples = 3600;
+
+// Config sections holding a named profile
+constexpr char kProfilePrefix[] = "profile-";
+} // namespace
+
+DaemonService::DaemonService(QObject *parent)
+    : QObject(parent), m_history(kHistorySamples) {
+  PowerMonitor::registerDBusTypes();
   m_protector = new SystemProtector(this);
   m_powerMonitor = m_protector->powerMonitor();
   m_cpuController = m_protector->cpuController();
-  m_temperatureMonitor = new TemperatureMonitor(this);
+  m_temperatureMonitor = new TemperatureMonitor(m_powerMonitor, this);
+  m_fanController = new FanController(this);
+
+  // Property changes of one tick reach clients as one PropertiesChanged
+  m_propertyNotifier = new PropertyNotifier(this, "/org/uncrash/Daemon",
+                                            "org.uncrash.Daemon", this);
+  auto notify = [this](const char *property) {
+    return [this, property]() { m_propertyNotifier->markChanged(property); };
+  };
+
+  // A random epoch in the high bits, so a client's version from before a
+  // daemon restart never matches one of the new process
+  m_statusVersion = qulonglong(QRandomGenerator::system()->generate()) << 32;
+
+  // The status snapshot follows every tick and every property change
+  connect(m_propertyNotifier, &PropertyNotifier::changed, this,
+          [this]() { m_statusStale = true; });
 
-  // Connect internal signals to DBus signals
   connect(m_powerMonitor, &PowerMonitor::gpuPowerChanged, this,
-          &DaemonService::onGpuPowerChanged);
+          notify("GpuPower"));
   connect(m_powerMonitor, &PowerMonitor::gpuPowerThresholdChanged, this,
-          &DaemonService::onGpuPowerThresholdChanged);
+          notify("GpuPowerThreshold"));
   connect(m_powerMonitor, &PowerMonitor::thresholdExceededChanged, this,
-          &DaemonService::onThresholdExceededChanged);
+          notify("ThresholdExceeded"));
+  connect(m_powerMonitor, &PowerMonitor::gpuStateChanged, this,
+          notify("GpuState"));
+  connect(m_powerMonitor, &PowerMonitor::gpuInstantPowerChanged, this,
+          notify("GpuInstantPower"));
+  connect(m_powerMonitor, &PowerMonitor::gpuPowerModeChanged, this,
+          notify("GpuPowerMode"));
+  connect(m_powerMonitor, &PowerMonitor::gpuPowerModeChanged, this,
+          &DaemonService::updatePeakSampling);
 
   connect(m_cpuController, &CpuController::currentMaxFrequencyChanged, this,
-          &DaemonService::onCurrentMaxFrequencyChanged);
+          notify("CurrentMaxFrequency"));
   connect(m_cpuController, &CpuController::currentFrequencyChanged, this,
-          &DaemonService::onCurrentFrequencyChanged);
+          notify("CurrentFrequency"));
   connect(m_cpuController, &CpuController::maxFrequencyChanged, this,
-          &DaemonService::onMaxFrequencyChanged);
+          notify("MaxFrequency"));
   connect(m_cpuController, &CpuController::regulationEnabledChanged, this,
-          &DaemonService::onRegulationEnabledChanged);
+          notify("RegulationEnabled"));
   connect(m_cpuController, &CpuController::cpuLimitAppliedChanged, this,
-          &DaemonService::onCpuLimitAppliedChanged);
+          notify("CpuLimitApplied"));
+  connect(m_cpuController, &CpuController::externalLimitChangesChanged, this,
+          notify("ExternalLimitChanges"));
+  connect(m_cpuController, &CpuController::adaptiveCeilingChanged, this,
+          notify("AdaptiveCeiling"));
+  connect(m_cpuController, &CpuController::selectedCeilingChanged, this,
+          [this]() {
+            m_propertyNotifier->markChanged("SelectedCeiling");
+            m_propertyNotifier->markChanged("CeilingReason");
+          });
 
   connect(m_protector, &SystemProtector::autoProtectionChanged, this,
-          &DaemonService::onAutoProtectionChanged);
+          notify("AutoProtection"));
   connect(m_protector, &SystemProtector::cooldownSecondsChanged, this,
-          &DaemonService::onCooldownSecondsChanged);
+          notify("CooldownSeconds"));
+  connect(m_protector, &SystemProtector::cpuHotspotThresholdChanged, this,
+          notify("CpuHotspotThreshold"));
 
   // Connect temperature monitor signals
   connect(m_temperatureMonitor, &TemperatureMonitor::gpuTemperatureChanged,
-          this, &DaemonService::GpuTemperatureChanged);
+          this, notify("GpuTemperature"));
   connect(m_temperatureMonitor, &TemperatureMonitor::cpuTemperatureChanged,
-          this, &DaemonService::CpuTemperatureChanged);
+          this, notify("CpuTemperature"));
+  connect(m_temperatureMonitor, &TemperatureMonitor::cpuHotspotChanged, this,
+          [this]() {
+            m_protector->updateCpuHotspot(cpuHotspotTemperature());
+            m_propertyNotifier->markChanged("CpuHotspotTemperature");
+            m_propertyNotifier->markChanged("CpuCoreMeanTemperature");
+            m_propertyNotifier->markChanged("CpuHottestCore");
+          });
   connect(m_temperatureMonitor,
           &TemperatureMonitor::motherboardTemperatureChanged, this,
-          &DaemonService::MotherboardTemperatureChanged);
+          notify("MotherboardTemperature"));
   connect(m_temperatureMonitor, &TemperatureMonitor::fanSpeedsChanged, this,
           [this]() {
-            emit CpuFanSpeedChanged(cpuFanSpeed());
-            emit GpuFanSpeedChanged(gpuFanSpeed());
+            m_propertyNotifier->markChanged("CpuFanSpeed");
+            m_propertyNotifier->markChanged("GpuFanSpeed");
           });
 
-  // Start temperature monitoring (update every 2 seconds)
-  m_temperatureMonitor->startMonitoring(2000);
+  // Spin up the fans as temperatures or GPU power rise
+  connect(m_temperatureMonitor, &TemperatureMonitor::temperaturesUpdated, this,
+          &DaemonService::updateFans);
+  connect(m_powerMonitor, &PowerMonitor::gpuPowerChanged, this,
+          &DaemonService::updateFans);
+  connect(m_fanController, &FanController::enabledChanged, this,
+          notify("FanControlEnabled"));
+  connect(m_fanController, &FanController::dutyChanged, this,
+          notify("FanDuty"));
+  connect(m_fanController, &FanController::curvesChanged, this, [this]() {
+    m_propertyNotifier->markChanged("FanTemperatureCurve");
+    m_propertyNotifier->markChanged("FanGpuPowerCurve");
+  });
+
+  // All hwmon channels for clients, independent of the protection inputs
+  HwmonSensorTable::registerDBusTypes();
+  m_sensorTable = new HwmonSensorTable(this);
+  connect(m_sensorTable, &HwmonSensorTable::rebuilt, this,
+          [this]() { emit SensorTableChanged(m_sensorTable->generation()); });
+
+  // Hardware probes finish in the background after the DBus name is taken
+  connect(m_temperatureMonitor, &TemperatureMonitor::bindingsChanged, this,
+          &DaemonService::onSensorBindingsChanged);
+  connect(m_powerMonitor, &PowerMonitor::devicesChanged, this,
+          &DaemonService::onGpuDevicesChanged);
+  connect(m_powerMonitor, &PowerMonitor::gpuDeviceThresholdsChanged, this,
+          &DaemonService::GpuDevicesChanged);
+
+  // What the protection costs, for users who want it justified. /run is
+  // cleared on reboot, the boot_id in the file covers systems where it
+  // isn't.
+  m_throttleAccounting = new ThrottleAccounting(m_cpuController, this);
+  m_throttleAccounting->setStatePath("/run/uncrash/throttle-totals.json");
+
+  // Follow late driver loads, GPU resets and hotplug instead of polling
+  m_ueventMonitor = new UeventMonitor(this);
+  connect(m_ueventMonitor, &UeventMonitor::ueventReceived, this,
+          &DaemonService::onUevent);
+  connect(m_ueventMonitor, &UeventMonitor::overflowed, this, [this]() {
+    m_powerMonitor->startProbe();
+    m_temperatureMonitor->startProbe();
+    m_sensorTable->startRebuild();
+  });
+
+  // Switch to the profiles of heavy applications as they start and stop
+  m_procEventMonitor = new ProcEventMonitor(this);
+  connect(m_procEventMonitor, &ProcEventMonitor::processExecuted, this,
+          &DaemonService::onProcessExecuted);
+  connect(m_procEventMonitor, &ProcEventMonitor::processExited, this,
+          &DaemonService::onProcessExited);
+  connect(m_procEventMonitor, &ProcEventMonitor::overflowed, this,
+          &DaemonService::scanProcesses);
+
+  // Drive all sampling from one phase-aligned timer, GPU power is the
+  // protection input and is registered once the first GPU is found
+  m_scheduler = new TickScheduler(this);
+  m_scheduler->registerSource(
+      "cpuFrequency", 2000, TickScheduler::Priority::Normal,
+      [this]() { m_cpuController->updateCurrentFrequency(); });
+  m_scheduler->registerSource(
+      "cpuLimitOwnership", 1000, TickScheduler::Priority::Normal,
+      [this]() { m_cpuController->reconcilePolicies(); });
+  m_scheduler->registerSource("cpuCeiling", 1000,
+                              TickScheduler::Priority::Normal,
+                              [this]() { m_cpuController->updateCeiling(); });
+  m_scheduler->registerSource(
+      "temperatures", 2000, TickScheduler::Priority::Normal,
+      [this]() { m_temperatureMonitor->updateSensors(); });
+  m_scheduler->registerSource("sensorTable", 2000,
+                              TickScheduler::Priority::Background,
+                              [this]() { m_sensorTable->sample(); });
+  m_scheduler->registerSource("throttleAccounting", 1000,
+                              TickScheduler::Priority::Normal,
+                              [this]() { m_throttleAccounting->sample(); });
 
-  // Emit initial GPU vendor/name
-  emit GpuVendorChanged(m_temperatureMonitor->gpuVendor());
-  emit GpuNameChanged(m_temperatureMonitor->gpuName());
+  connect(m_scheduler, &TickScheduler::tickFinished, this,
+          [this]() { m_statusStale = true; });
+
+  // Per-client telemetry, sampled only while someone listens, and the last
+  // hour of the same fields for charts and postmortems
+  m_telemetry = new TelemetryPublisher(m_scheduler, "/org/uncrash/Daemon",
+                                       "org.uncrash.Daemon", this);
+  m_telemetryChannel = new TelemetryChannel(m_scheduler, this);
+  addTelemetryFields();
+  m_scheduler->registerSource(
+      "history", kHistoryIntervalMs, TickScheduler::Priority::Normal,
+      [this]() { m_history.sample(HistoryRing::monotonicNs()); });
 
   // Load settings
+  m_configStore = new ConfigStore("/etc/uncrash/uncrash.conf", this);
   loadSettings();
+
+  // Apply edits by configuration management without a restart. Editors and
+  // ConfigStore replace the file, so its directory is watched as well.
+  m_reloadTimer = new QTimer(this);
+  m_reloadTimer->setSingleShot(true);
+  m_reloadTimer->setInterval(200);
+  connect(m_reloadTimer, &QTimer::timeout, this,
+          &DaemonService::onReloadTimeout);
+
+  m_configWatcher = new QFileSystemWatcher(this);
+  QFileInfo config(m_configStore->path());
+  m_configWatcher->addPath(config.absolutePath());
+  if (config.exists()) {
+    m_configWatcher->addPath(config.absoluteFilePath());
+  }
+  connect(m_configWatcher, &QFileSystemWatcher::fileChanged, this,
+          [this]() { reloadSettings("inotify"); });
+  connect(m_configWatcher, &QFileSystemWatcher::directoryChanged, this,
+          [this]() { reloadSettings("inotify"); });
+}
+
+DaemonService::~DaemonService() {
+  qInfo() << "Sampling wakeups per second:" << m_scheduler->wakeupsPerSecond();
+  saveSettings();
+  m_configStore->flush();
+
+  // Don't let probes deliver results into destroyed monitors
+  QThreadPool::globalInstance()->waitForDone();
 }
 
-DaemonService::~DaemonService() { saveSettings(); }
+void DaemonService::start() {
+  m_startupClock.start();
+
+  // Listen before probing, so no device added meanwhile is missed
+  m_ueventMonitor->start();
+  updateProcessRules();
+
+  // All probes run concurrently, nothing here blocks the event loop
+  m_powerMonitor->startProbe();
+  m_temperatureMonitor->startProbe();
+  m_sensorTable->startRebuild();
+  m_scheduler->start();
+}
 
 bool DaemonService::registerService() {
   QDBusConnection bus = QDBusConnection::systemBus();
@@ -90,6 +271,14 @@ double DaemonService::gpuPowerThreshold() const {
   return m_powerMonitor->gpuPowerThreshold();
 }
 
+double DaemonService::gpuInstantPower() const {
+  return m_powerMonitor->gpuInstantPower();
+}
+
+QString DaemonService::gpuPowerMode() const {
+  return m_powerMonitor->gpuPowerMode();
+}
+
 double DaemonService::currentMaxFrequency() const {
   return m_cpuController->currentMaxFrequency();
 }
@@ -122,6 +311,22 @@ bool DaemonService::cpuLimitApplied() const {
   return m_cpuController->cpuLimitApplied();
 }
 
+int DaemonService::externalLimitChanges() const {
+  return m_cpuController->externalLimitChanges();
+}
+
+bool DaemonService::adaptiveCeiling() const {
+  return m_cpuController->adaptiveCeiling();
+}
+
+double DaemonService::selectedCeiling() const {
+  return m_cpuController->selectedCeiling();
+}
+
+QString DaemonService::ceilingReason() const {
+  return m_cpuController->ceilingReason();
+}
+
 // Temperature getters
 double DaemonService::gpuTemperature() const {
   return m_temperatureMonitor->gpuTemperature();
@@ -139,6 +344,22 @@ int DaemonService::cpuFanSpeed() const {
   return m_temperatureMonitor->cpuFanSpeed();
 }
 
+double DaemonService::cpuHotspotTemperature() const {
+  return m_temperatureMonitor->cpuHotspotTemperature();
+}
+
+double DaemonService::cpuCoreMeanTemperature() const {
+  return m_temperatureMonitor->cpuCoreMeanTemperature();
+}
+
+int DaemonService::cpuHottestCore() const {
+  return m_temperatureMonitor->cpuHottestCore();
+}
+
+double DaemonService::cpuHotspotThreshold() const {
+  return m_protector->cpuHotspotThreshold();
+}
+
 double DaemonService::motherboardTemperature() const {
   return m_temperatureMonitor->motherboardTemperature();
 }
@@ -151,12 +372,35 @@ QString DaemonService::gpuName() const {
   return m_temperatureMonitor->gpuName();
 }
 
+QString DaemonService::gpuState() const { return m_powerMonitor->gpuState(); }
+
+// Fan control getters
+bool DaemonService::fanControlEnabled() const {
+  return m_fanController->enabled();
+}
+
+int DaemonService::fanDuty() const { return m_fanController->duty(); }
+
+QString DaemonService::fanTemperatureCurve() const {
+  return m_fanController->temperatureCurve();
+}
+
+QString DaemonService::fanGpuPowerCurve() const {
+  return m_fanController->gpuPowerCurve();
+}
+
 // Property setters
 void DaemonService::setGpuPowerThreshold(double threshold) {
   m_powerMonitor->setGpuPowerThreshold(threshold);
   saveSettings();
 }
 
+void DaemonService::setGpuPowerMode(const QString &mode) {
+  if (m_powerMonitor->setGpuPowerMode(mode)) {
+    saveSettings();
+  }
+}
+
 void DaemonService::setMaxFrequency(double frequency) {
   m_cpuController->setMaxFrequency(frequency);
   saveSettings();
@@ -177,6 +421,33 @@ void DaemonService::setCooldownSeconds(int seconds) {
   saveSettings();
 }
 
+void DaemonService::setAdaptiveCeiling(bool enabled) {
+  m_cpuController->setAdaptiveCeiling(enabled);
+  saveSettings();
+}
+
+void DaemonService::setCpuHotspotThreshold(double threshold) {
+  m_protector->setCpuHotspotThreshold(threshold);
+  saveSettings();
+}
+
+void DaemonService::setFanControlEnabled(bool enabled) {
+  m_fanController->setEnabled(enabled);
+  saveSettings();
+}
+
+void DaemonService::setFanTemperatureCurve(const QString &curve) {
+  if (m_fanController->setTemperatureCurve(curve)) {
+    saveSettings();
+  }
+}
+
+void DaemonService::setFanGpuPowerCurve(const QString &curve) {
+  if (m_fanController->setGpuPowerCurve(curve)) {
+    saveSettings();
+  }
+}
+
 // DBus methods
 bool DaemonService::ApplyFrequencyLimit() {
   m_cpuController->applyFrequencyLimit();
@@ -191,9 +462,43 @@ bool DaemonService::RemoveFrequencyLimit() {
 }
 
 QVariantMap DaemonService::GetStatus() {
+  QVariantMap status = statusSnapshot();
+  addStatusCounters(&status);
+  return status;
+}
+
+qulonglong DaemonService::GetStatusIfChanged(qulonglong lastVersion,
+                                             QVariantMap &status) {
+  const QVariantMap &snapshot = statusSnapshot();
+  if (m_statusVersion != lastVersion) {
+    status = snapshot;
+    addStatusCounters(&status);
+  }
+  return m_statusVersion;
+}
+
+const QVariantMap &DaemonService::statusSnapshot() {
+  // Rebuilt at most once per tick and only when someone asks. Running
+  // counters are not part of it, they would change the version on every
+  // rebuild.
+  if (m_statusStale) {
+    m_statusStale = false;
+
+    QVariantMap status = buildStatus();
+    if (status != m_status) {
+      m_status = status;
+      m_statusVersion++;
+    }
+  }
+  return m_status;
+}
+
+QVariantMap DaemonService::buildStatus() const {
   QVariantMap status;
   status["gpuPower"] = gpuPower();
   status["gpuPowerThreshold"] = gpuPowerThreshold();
+  status["gpuInstantPower"] = gpuInstantPower();
+  status["gpuPowerMode"] = gpuPowerMode();
   status["currentMaxFrequency"] = currentMaxFrequency();
   status["currentFrequency"] = currentFrequency();
   status["maxFrequency"] = maxFrequency();
@@ -202,81 +507,798 @@ QVariantMap DaemonService::GetStatus() {
   status["cooldownSeconds"] = cooldownSeconds();
   status["thresholdExceeded"] = thresholdExceeded();
   status["cpuLimitApplied"] = cpuLimitApplied();
+  status["externalLimitChanges"] = externalLimitChanges();
+  status["adaptiveCeiling"] = adaptiveCeiling();
+  status["selectedCeiling"] = selectedCeiling();
+  status["ceilingReason"] = ceilingReason();
 
   // Add temperature data
   status["gpuTemperature"] = gpuTemperature();
   status["gpuFanSpeed"] = gpuFanSpeed();
   status["cpuTemperature"] = cpuTemperature();
   status["cpuFanSpeed"] = cpuFanSpeed();
+  status["cpuHotspotTemperature"] = cpuHotspotTemperature();
+  status["cpuCoreMeanTemperature"] = cpuCoreMeanTemperature();
+  status["cpuHottestCore"] = cpuHottestCore();
+  status["cpuHotspotThreshold"] = cpuHotspotThreshold();
   status["motherboardTemperature"] = motherboardTemperature();
   status["gpuVendor"] = gpuVendor();
   status["gpuName"] = gpuName();
+  status["gpuState"] = gpuState();
+  status["gpuDeviceCount"] = m_powerMonitor->devices().size();
+
+  // Add fan control data
+  status["fanControlEnabled"] = fanControlEnabled();
+  status["fanDuty"] = fanDuty();
+
+  // Add sensor filter statistics
+  status["rejectedSamples"] = m_powerMonitor->filterCounters().rejected() +
+                              m_temperatureMonitor->filterCounters().rejected();
+  status["falseTripsAvoided"] = m_powerMonitor->falseTripsAvoided();
+
+  // Add throttle accounting since boot
+  status["throttleEngagements"] =
+      m_throttleAccounting->bootTotals().engagements;
+
+  status["processProfile"] = m_processProfile;
+  status["telemetrySubscribers"] = m_telemetry->subscriberCount();
+  status["telemetryChannelReaders"] = m_telemetryChannel->readerCount();
 
   return status;
 }
 
-// Signal forwarding slots
-void DaemonService::onGpuPowerChanged() { emit GpuPowerChanged(gpuPower()); }
+void DaemonService::addStatusCounters(QVariantMap *status) const {
+  // Change on every tick or call, read fresh and left out of the version
+  status->insert("throttledSeconds",
+                 m_throttleAccounting->bootTotals().throttledSeconds);
+  status->insert("wakeupsPerSecond", m_scheduler->wakeupsPerSecond());
+  status->insert("propertiesChangedSignals",
+                 m_propertyNotifier->emittedSignals());
+  status->insert("telemetrySamples", m_telemetry->sentSamples());
+  status->insert("telemetrySkippedSamples", m_telemetry->skippedSamples());
+  status->insert("telemetryChannelRecords",
+                 m_telemetryChannel->writtenRecords());
+}
 
-void DaemonService::onGpuPowerThresholdChanged() {
-  emit GpuPowerThresholdChanged(gpuPowerThreshold());
+QVariantMap DaemonService::GetLimitDrift() {
+  return m_cpuController->limitDrift();
 }
 
-void DaemonService::onCurrentMaxFrequencyChanged() {
-  emit CurrentMaxFrequencyChanged(currentMaxFrequency());
+QVariantMap DaemonService::GetThrottleImpact() {
+  return m_throttleAccounting->report();
 }
 
-void DaemonService::onCurrentFrequencyChanged() {
-  emit CurrentFrequencyChanged(currentFrequency());
+QVariantMap DaemonService::GetSensorFilterStats() {
+  QVariantMap stats;
+  stats["gpu"] = m_powerMonitor->filterCounters().toVariantMap();
+  stats["temperatures"] =
+      m_temperatureMonitor->filterCounters().toVariantMap();
+  stats["falseTripsAvoided"] = m_powerMonitor->falseTripsAvoided();
+  return stats;
 }
 
-void DaemonService::onMaxFrequencyChanged() {
-  emit MaxFrequencyChanged(maxFrequency());
+uint DaemonService::GetSensorChannels(QList<SensorChannelInfo> &channels) {
+  channels = m_sensorTable->channels();
+  return m_sensorTable->generation();
 }
 
-void DaemonService::onRegulationEnabledChanged() {
-  emit RegulationEnabledChanged(regulationEnabled());
+uint DaemonService::GetSensorValues(QList<SensorReading> &values) {
+  values = m_sensorTable->readings();
+  return m_sensorTable->generation();
 }
 
-void DaemonService::onAutoProtectionChanged() {
-  emit AutoProtectionChanged(autoProtection());
+QList<GpuDeviceStatus> DaemonService::GetGpuDevices() {
+  return m_powerMonitor->devices();
 }
 
-void DaemonService::onCooldownSecondsChanged() {
-  emit CooldownSecondsChanged(cooldownSeconds());
+bool DaemonService::SetGpuDeviceThreshold(const QString &id,
+                                          double threshold) {
+  if (id.isEmpty() || threshold < 0) {
+    return false;
+  }
+
+  m_powerMonitor->setGpuDeviceThreshold(id, threshold);
+  saveSettings();
+  return true;
 }
 
-void DaemonService::onThresholdExceededChanged() {
-  emit ThresholdExceededChanged(thresholdExceeded());
+QVariantMap DaemonService::GetHistory(qulonglong sinceMonotonicNs,
+                                      uint maxPoints) {
+  return m_history.history(
+      sinceMonotonicNs, int(qMin(maxPoints, uint(m_history.capacity()))));
 }
 
-void DaemonService::onCpuLimitAppliedChanged() {
-  emit CpuLimitAppliedChanged(cpuLimitApplied());
+QDBusUnixFileDescriptor DaemonService::GetTelemetryFd() {
+  if (!calledFromDBus()) {
+    return QDBusUnixFileDescriptor();
+  }
+
+  if (!(connection().connectionCapabilities() &
+        QDBusConnection::UnixFileDescriptorPassing)) {
+    sendErrorReply(QDBusError::NotSupported,
+                   "The bus does not support passing file descriptors");
+    return QDBusUnixFileDescriptor();
+  }
+
+  QDBusUnixFileDescriptor fd = m_telemetryChannel->open(message().service());
+  if (!fd.isValid()) {
+    sendErrorReply(QDBusError::Failed,
+                   "Failed to create the telemetry channel");
+  }
+  return fd;
 }
 
-void DaemonService::loadSettings() {
-  QSettings settings("/etc/uncrash/uncrash.conf", QSettings::IniFormat);
+QStringList DaemonService::Subscribe(double rateHz,
+                                     const QStringList &fields) {
+  if (!calledFromDBus()) {
+    return QStringList();
+  }
 
-  double threshold = settings.value("gpuPowerThreshold", 100.0).toDouble();
-  double frequency = settings.value("cpuMaxFrequency", 3.5).toDouble();
-  bool autoProtect = settings.value("autoProtection", true).toBool();
-  int cooldown = settings.value("cooldownSeconds", 5).toInt();
+  QString error;
+  QStringList subscribed =
+      m_telemetry->subscribe(message().service(), rateHz, fields, &error);
+  if (subscribed.isEmpty()) {
+    sendErrorReply(QDBusError::InvalidArgs, error);
+  }
+  return subscribed;
+}
 
-  m_powerMonitor->setGpuPowerThreshold(threshold);
-  m_cpuController->setMaxFrequency(frequency);
-  m_protector->setAutoProtection(autoProtect);
-  m_protector->setCooldownSeconds(cooldown);
+bool DaemonService::Unsubscribe() {
+  if (!calledFromDBus()) {
+    return false;
+  }
+
+  return m_telemetry->unsubscribe(message().service());
+}
 
-  qInfo() << "Settings loaded from /etc/uncrash/uncrash.conf";
+QStringList DaemonService::ListProfiles(QString &active) {
+  // Only while the settings still match it, a later property write makes
+  // the policy no longer the profile's
+  active.clear();
+  auto profile = m_profiles.constFind(m_activeProfile);
+  if (profile != m_profiles.constEnd()) {
+    const QVariantMap current = currentSettings();
+    bool matches = true;
+    const QVariantMap &values = profile->settings;
+    for (auto it = values.begin(); it != values.end(); ++it) {
+      matches = matches && current.value(it.key()) == it.value();
+    }
+    if (matches) {
+      active = m_activeProfile;
+    }
+  }
+  return m_profiles.keys();
+}
+
+QStringList DaemonService::ActivateProfile(const QString &name) {
+  auto profile = m_profiles.constFind(name);
+  if (profile == m_profiles.constEnd()) {
+    if (calledFromDBus()) {
+      sendErrorReply(QDBusError::InvalidArgs,
+                     QString("No profile named \"%1\"").arg(name));
+    }
+    return QStringList();
+  }
+
+  QVariantMap settings = currentSettings();
+  const QVariantMap &values = profile->settings;
+  for (auto it = values.begin(); it != values.end(); ++it) {
+    settings.insert(it.key(), it.value());
+  }
+
+  QStringList changed = applySettings(settings);
+  m_activeProfile = name;
+  saveSettings();
+
+  qInfo() << "Profile" << name << "activated, changed:" << changed;
+  return changed;
+}
+
+QStringList DaemonService::SetConfig(const QVariantMap &config) {
+  // Validated as a whole, an invalid key leaves every setting as it was
+  QVariantMap settings = currentSettings();
+  QStringList errors;
+  for (auto it = config.begin(); it != config.end(); ++it) {
+    QString text = settingText(it.value());
+    QVariant value;
+    if (!parseSetting(it.key(), text, &value)) {
+      errors.append(QString("%1=%2").arg(it.key(), text));
+      continue;
+    }
+    settings.insert(it.key(), value);
+  }
+
+  if (!errors.isEmpty()) {
+    qWarning() << "SetConfig rejected:" << errors;
+    if (calledFromDBus()) {
+      sendErrorReply(QDBusError::InvalidArgs,
+                     "Invalid settings: " + errors.join("; "));
+    }
+    return QStringList();
+  }
+
+  QStringList changed = applySettings(settings);
+  if (!changed.isEmpty()) {
+    saveSettings();
+    qInfo() << "SetConfig changed:" << changed;
+  }
+  return changed;
+}
+
+void DaemonService::onProcessExecuted(int pid) {
+  bool wasMatched = m_processProfiles.contains(pid);
+  matchProcess(pid);
+  if (wasMatched || m_processProfiles.contains(pid)) {
+    updateProcessProfile();
+  }
+}
+
+void DaemonService::onProcessExited(int pid) {
+  if (m_processProfiles.remove(pid)) {
+    updateProcessProfile();
+  }
+}
+
+void DaemonService::updateProcessRules() {
+  QList<ProcessMatcher::Rule> rules;
+  for (auto it = m_profiles.begin(); it != m_profiles.end(); ++it) {
+    for (const QString &pattern : std::as_const(it->processes)) {
+      rules.append({pattern, it.key()});
+    }
+  }
+
+  if (rules == m_processMatcher.rules()) {
+    return;
+  }
+  m_processMatcher.setRules(rules);
+
+  // Without rules the kernel doesn't have to report every process to us
+  if (m_processMatcher.isEmpty()) {
+    m_procEventMonitor->stop();
+  } else if (m_procEventMonitor->start()) {
+    qInfo() << "Matching processes for" << rules.size() << "rules";
+  } else {
+    qWarning() << "Process rules need the proc connector, ignoring them";
+  }
+
+  scanProcesses();
+}
+
+void DaemonService::scanProcesses() {
+  // Only when the rules change or events were lost, the proc connector
+  // reports every exec and exit in between
+  m_processProfiles.clear();
+  m_processProfileOrder.clear();
+
+  if (m_procEventMonitor->isRunning()) {
+    const QStringList entries =
+        QDir("/proc").entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &entry : entries) {
+      bool ok;
+      int pid = entry.toInt(&ok);
+      if (ok) {
+        matchProcess(pid);
+      }
+    }
+  }
+
+  updateProcessProfile();
+}
+
+void DaemonService::matchProcess(int pid) {
+  // Empty for kernel threads and processes that are already gone
+  QString executable =
+      QFile::symLinkTarget(QString("/proc/%1/exe").arg(pid));
+  QString profile =
+      executable.isEmpty() ? QString() : m_processMatcher.match(executable);
+
+  // Also drops processes that exec'd something else
+  if (profile.isEmpty()) {
+    m_processProfiles.remove(pid);
+    return;
+  }
+
+  m_processProfiles.insert(pid, profile);
+  m_processProfileOrder.removeOne(profile);
+  m_processProfileOrder.append(profile);
+}
+
+void DaemonService::updateProcessProfile() {
+  // Forget profiles whose processes have all exited
+  QSet<QString> running;
+  for (const QString &profile : std::as_const(m_processProfiles)) {
+    running.insert(profile);
+  }
+  m_processProfileOrder.removeIf([&running](const QString &profile) {
+    return !running.contains(profile);
+  });
+
+  QString profile = m_processProfileOrder.isEmpty()
+                        ? QString()
+                        : m_processProfileOrder.last();
+  if (profile == m_processProfile) {
+    return;
+  }
+
+  // Undo the previous profile first, so keys the next one doesn't set go
+  // back to their own values. Nothing is saved, the switch is temporary.
+  QVariantMap settings = currentSettings();
+  for (auto it = m_processRestore.begin(); it != m_processRestore.end();
+       ++it) {
+    settings.insert(it.key(), it.value());
+  }
+
+  QString previous = m_processProfile;
+  m_processProfile = profile;
+  QStringList changed = applySettings(withProcessProfile(settings, profile));
+  m_statusStale = true;
+
+  qInfo() << "Process profile" << (previous.isEmpty() ? "none" : previous)
+          << "->" << (profile.isEmpty() ? "none" : profile)
+          << ", changed:" << changed;
+}
+
+QVariantMap DaemonService::withProcessProfile(QVariantMap settings,
+                                              const QString &name) {
+  // Remembers what the profile replaces, for when its processes are gone
+  m_processRestore.clear();
+  auto profile = m_profiles.constFind(name);
+  if (profile == m_profiles.constEnd()) {
+    return settings;
+  }
+
+  const QVariantMap &values = profile->settings;
+  for (auto it = values.begin(); it != values.end(); ++it) {
+    m_processRestore.insert(it.key(), settings.value(it.key()));
+    settings.insert(it.key(), it.value());
+  }
+  return settings;
+}
+
+void DaemonService::addTelemetryFields() {
+  using Aggregate = HistoryRing::Aggregate;
+
+  // Every field is offered to subscribers and the shared-memory channel and
+  // kept in the history
+  auto add = [this](const QString &name, Aggregate aggregate,
+                    std::function<double()> read) {
+    m_telemetry->addField(name, read);
+    m_telemetryChannel->addField(name, read);
+    m_history.addColumn(name, aggregate, read);
+  };
+
+  add("gpuPower", Aggregate::Max, [this]() { return gpuPower(); });
+  add("gpuInstantPower", Aggregate::Max,
+      [this]() { return gpuInstantPower(); });
+  add("currentFrequency", Aggregate::Mean,
+      [this]() { return currentFrequency(); });
+  add("currentMaxFrequency", Aggregate::Min,
+      [this]() { return currentMaxFrequency(); });
+  add("selectedCeiling", Aggregate::Min,
+      [this]() { return selectedCeiling(); });
+  add("thresholdExceeded", Aggregate::Max,
+      [this]() { return thresholdExceeded() ? 1.0 : 0.0; });
+  add("cpuLimitApplied", Aggregate::Max,
+      [this]() { return cpuLimitApplied() ? 1.0 : 0.0; });
+  add("gpuTemperature", Aggregate::Max, [this]() { return gpuTemperature(); });
+  add("cpuTemperature", Aggregate::Max, [this]() { return cpuTemperature(); });
+  add("cpuHotspotTemperature", Aggregate::Max,
+      [this]() { return cpuHotspotTemperature(); });
+  add("motherboardTemperature", Aggregate::Max,
+      [this]() { return motherboardTemperature(); });
+  add("gpuFanSpeed", Aggregate::Max,
+      [this]() { return double(gpuFanSpeed()); });
+  add("cpuFanSpeed", Aggregate::Max,
+      [this]() { return double(cpuFanSpeed()); });
+  add("fanDuty", Aggregate::Max, [this]() { return double(fanDuty()); });
+}
+
+void DaemonService::onGpuDevicesChanged() {
+  emit GpuDevicesChanged();
+  updatePeakSampling();
+
+  if (m_gpuPowerSourceRegistered || !m_powerMonitor->hasDevices())
+    return;
+
+  // Start the protection loop right away, the first sample runs on the
+  // next scheduler wakeup
+  m_gpuPowerSourceRegistered = true;
+  m_scheduler->registerSource(
+      "gpuPower", 1000, TickScheduler::Priority::Critical, [this]() {
+        m_powerMonitor->updateGpuPower();
+
+        if (!m_protectionStarted) {
+          m_protectionStarted = true;
+          qInfo() << "Time to first protection:" << m_startupClock.elapsed()
+                  << "ms";
+        }
+      });
+}
+
+void DaemonService::updatePeakSampling() {
+  // Fast samples of power1_input and energy counters between the 1 s
+  // ticks, only paid for in instant mode and with a GPU that has either.
+  // NVIDIA GPUs get their instant power from the regular tick.
+  bool wanted =
+      m_powerMonitor->powerMode() == PowerMonitor::PowerMode::Instant &&
+      m_powerMonitor->hasPeakPowerSources();
+  if (wanted == m_peakPowerSourceRegistered)
+    return;
+
+  m_peakPowerSourceRegistered = wanted;
+  if (wanted) {
+    m_scheduler->registerSource(
+        "gpuPeakPower", 50, TickScheduler::Priority::Critical,
+        [this]() { m_powerMonitor->samplePeakPower(); });
+  } else {
+    m_scheduler->unregisterSource("gpuPeakPower");
+  }
+}
+
+void DaemonService::onUevent(const Uevent &event) {
+  if (event.subsystem != "hwmon" && event.subsystem != "drm" &&
+      event.subsystem != "cpu") {
+    return;
+  }
+
+  qDebug() << "Uevent:" << event.action << event.subsystem << event.devpath;
+
+  m_powerMonitor->handleUevent(event);
+  m_temperatureMonitor->handleUevent(event);
+  m_cpuController->handleUevent(event);
+  m_sensorTable->handleUevent(event);
+}
+
+void DaemonService::onSensorBindingsChanged() {
+  m_fanController->setHwmonPath(m_temperatureMonitor->motherboardHwmonPath());
+
+  m_propertyNotifier->markChanged("GpuVendor");
+  m_propertyNotifier->markChanged("GpuName");
+}
+
+void DaemonService::updateFans() {
+  double temperature = std::max(cpuTemperature(), motherboardTemperature());
+  m_fanController->update(temperature, gpuPower());
+}
+
+void DaemonService::loadSettings() {
+  QVariantMap settings;
+  QStringList errors;
+  readSettings(&settings, &m_profiles, &errors);
+  for (const QString &error : std::as_const(errors)) {
+    qWarning() << "Ignoring invalid setting:" << error;
+  }
+
+  QSettings file(m_configStore->path(), QSettings::IniFormat);
+  m_activeProfile = file.value("activeProfile").toString();
+
+  m_storedSettings = settings;
+  m_storedSettings["activeProfile"] = m_activeProfile;
+  applySettings(settings);
+  if (!m_profiles.isEmpty()) {
+    qInfo() << "Profiles:" << m_profiles.keys();
+  }
+  qInfo() << "Settings loaded from" << m_configStore->path();
 }
 
 void DaemonService::saveSettings() {
-  QSettings settings("/etc/uncrash/uncrash.conf", QSettings::IniFormat);
+  QVariantMap settings = currentSettings();
+
+  // A process profile lasts only as long as its processes, the file keeps
+  // the values it replaced. Values set over DBus meanwhile are kept.
+  const QVariantMap processValues = m_profiles.value(m_processProfile).settings;
+  for (auto it = m_processRestore.begin(); it != m_processRestore.end();
+       ++it) {
+    if (settings.value(it.key()) != processValues.value(it.key())) {
+      it.value() = settings.value(it.key());
+    }
+    settings.insert(it.key(), it.value());
+  }
+
+  settings["activeProfile"] = m_activeProfile;
+
+  // Only what changed since the file was read or written, so edits to
+  // other keys that land before the write are not rolled back
+  QVariantMap changed;
+  for (auto it = settings.begin(); it != settings.end(); ++it) {
+    if (m_storedSettings.value(it.key()) != it.value()) {
+      changed.insert(it.key(), it.value());
+      m_storedSettings.insert(it.key(), it.value());
+    }
+  }
+  if (changed.isEmpty()) {
+    return;
+  }
+
+  // Written behind on a worker thread, never blocks the event loop
+  m_configStore->save(changed);
+}
+
+void DaemonService::reloadSettings(const QString &trigger) {
+  m_reloadTrigger = trigger;
+  if (!m_reloadTimer->isActive()) {
+    m_reloadTimer->start();
+  }
+}
+
+void DaemonService::onReloadTimeout() {
+  // The file is replaced by a rename, watch the new one
+  QString path = m_configStore->path();
+  if (!m_configWatcher->files().contains(path) && QFile::exists(path)) {
+    m_configWatcher->addPath(path);
+  }
+
+  // Our own write is on its way, the file doesn't have our latest values
+  // yet and would roll them back
+  if (m_configStore->isBusy()) {
+    m_reloadTimer->start();
+    return;
+  }
+
+  QVariantMap settings;
+  QMap<QString, Profile> profiles;
+  QStringList errors;
+  readSettings(&settings, &profiles, &errors);
+
+  // All or nothing, a half-applied config is worse than the old one
+  if (!errors.isEmpty()) {
+    qWarning() << "Config reload (" << m_reloadTrigger
+               << ") rejected:" << errors;
+    emit ConfigReloaded(false, QStringList(), errors.join("; "));
+    return;
+  }
+
+  // The file holds the values below a running process profile
+  for (auto it = settings.begin(); it != settings.end(); ++it) {
+    m_storedSettings.insert(it.key(), it.value());
+  }
+  m_profiles = profiles;
+  settings = withProcessProfile(settings, m_processProfile);
+  QStringList changed = applySettings(settings);
+  updateProcessRules();
+  if (!changed.isEmpty()) {
+    qInfo() << "Config reloaded (" << m_reloadTrigger
+            << "), changed:" << changed;
+    emit ConfigReloaded(true, changed, QString());
+  } else if (m_reloadTrigger == "SIGHUP") {
+    // Always answer an explicit reload, file events of our own writes
+    // change nothing and stay quiet
+    emit ConfigReloaded(true, changed, QString());
+  }
+}
 
-  settings.setValue("gpuPowerThreshold", gpuPowerThreshold());
-  settings.setValue("cpuMaxFrequency", maxFrequency());
-  settings.setValue("autoProtection", autoProtection());
-  settings.setValue("cooldownSeconds", cooldownSeconds());
+QVariantMap DaemonService::currentSettings() const {
+  QVariantMap settings;
+  settings["gpuPowerThreshold"] = gpuPowerThreshold();
+  settings["gpuDeviceThresholds"] = gpuDeviceThresholds();
+  settings["gpuPowerMode"] = gpuPowerMode();
+  settings["cpuMaxFrequency"] = maxFrequency();
+  settings["autoProtection"] = autoProtection();
+  settings["cooldownSeconds"] = cooldownSeconds();
+  settings["adaptiveCeiling"] = adaptiveCeiling();
+  settings["cpuHotspotThreshold"] = cpuHotspotThreshold();
+  settings["fanControl"] = fanControlEnabled();
+  settings["fanTemperatureCurve"] = fanTemperatureCurve();
+  settings["fanGpuPowerCurve"] = fanGpuPowerCurve();
+  settings["propertiesChangedInterval"] = m_propertyNotifier->minimumInterval();
+  settings["telemetryChannelRateHz"] = m_telemetryChannel->rateHz();
+  return settings;
+}
+
+QVariantMap DaemonService::settingDefaults() const {
+  // Missing keys fall back to the defaults, the fan curves to the built-in
+  // ones. Not the curves in use, a reload of a file without them would
+  // otherwise keep curves that were removed from it.
+  QVariantMap defaults;
+  defaults["gpuPowerThreshold"] = 100.0;
+  defaults["gpuDeviceThresholds"] = QString();
+  defaults["gpuPowerMode"] = QString("average");
+  defaults["cpuMaxFrequency"] = 3.5;
+  defaults["autoProtection"] = true;
+  defaults["cooldownSeconds"] = 5;
+  defaults["adaptiveCeiling"] = false;
+  defaults["cpuHotspotThreshold"] = 0.0;
+  defaults["fanControl"] = false;
+  defaults["fanTemperatureCurve"] = FanController::defaultTemperatureCurve();
+  defaults["fanGpuPowerCurve"] = FanController::defaultGpuPowerCurve();
+  defaults["propertiesChangedInterval"] = 500;
+  defaults["telemetryChannelRateHz"] = 100;
+  return defaults;
+}
+
+QString DaemonService::settingText(const QVariant &raw) {
+  // Unquoted values with commas, like fan curves, are read as lists
+  return raw.typeId() == QMetaType::QStringList ? raw.toStringList().join(',')
+                                                : raw.toString();
+}
+
+bool DaemonService::parseSetting(const QString &key, const QString &text,
+                                 QVariant *value) const {
+  const QVariantMap defaults = settingDefaults();
+  if (!defaults.contains(key)) {
+    return false;
+  }
 
-  settings.sync();
+  bool ok = true;
+  switch (defaults[key].typeId()) {
+  case QMetaType::Double:
+    *value = text.toDouble(&ok);
+    break;
+  case QMetaType::Int:
+    *value = text.toInt(&ok);
+    break;
+  case QMetaType::Bool:
+    ok = text == "true" || text == "false" || text == "1" || text == "0";
+    *value = text == "true" || text == "1";
+    break;
+  default:
+    *value = text;
+    break;
+  }
+
+  if (key == "gpuPowerMode") {
+    ok = text == "average" || text == "instant";
+  } else if (key == "gpuDeviceThresholds") {
+    parseGpuDeviceThresholds(text, &ok);
+  } else if (key == "fanTemperatureCurve" || key == "fanGpuPowerCurve") {
+    FanController::parseCurve(text, &ok);
+  }
+  return ok;
+}
+
+void DaemonService::readSettings(QVariantMap *settings,
+                                 QMap<QString, Profile> *profiles,
+                                 QStringList *errors) const {
+  QSettings file(m_configStore->path(), QSettings::IniFormat);
+
+  const QVariantMap defaults = settingDefaults();
+  for (auto it = defaults.begin(); it != defaults.end(); ++it) {
+    const QString &key = it.key();
+    if (!file.contains(key)) {
+      settings->insert(key, it.value());
+      continue;
+    }
+
+    QString text = settingText(file.value(key));
+    QVariant value;
+    if (!parseSetting(key, text, &value)) {
+      errors->append(QString("%1=%2").arg(key, text));
+      continue;
+    }
+    settings->insert(key, value);
+  }
+
+  // [profile-<name>] sections hold any subset of the settings above and the
+  // executables that activate them
+  const QStringList groups = file.childGroups();
+  for (const QString &group : groups) {
+    if (!group.startsWith(kProfilePrefix)) {
+      continue;
+    }
+
+    Profile profile;
+    bool valid = true;
+    file.beginGroup(group);
+    const QStringList keys = file.childKeys();
+    for (const QString &key : keys) {
+      QString text = settingText(file.value(key));
+      if (key == "processes") {
+        profile.processes = text.split(',', Qt::SkipEmptyParts);
+        for (QString &pattern : profile.processes) {
+          pattern = pattern.trimmed();
+        }
+        continue;
+      }
+
+      QVariant value;
+      if (!parseSetting(key, text, &value)) {
+        errors->append(QString("%1/%2=%3").arg(group, key, text));
+        valid = false;
+        continue;
+      }
+      profile.settings.insert(key, value);
+    }
+    file.endGroup();
+
+    // A profile missing some of its keys would apply a policy nobody wrote
+    if (valid) {
+      profiles->insert(group.mid(qstrlen(kProfilePrefix)), profile);
+    }
+  }
+}
+
+QStringList DaemonService::applySettings(const QVariantMap &settings) {
+  const QVariantMap current = currentSettings();
+
+  QStringList changed;
+  for (auto it = settings.begin(); it != settings.end(); ++it) {
+    if (current.value(it.key()) != it.value()) {
+      changed.append(it.key());
+    }
+  }
+
+  // Applied in one go, no sampling tick sees a mix of old and new values,
+  // and the CPU limit is written once with its final value. Curves go
+  // before enabling the fan control, so it starts on the new ones.
+  m_cpuController->beginBatch();
+  if (changed.contains("gpuPowerThreshold"))
+    m_powerMonitor->setGpuPowerThreshold(
+        settings["gpuPowerThreshold"].toDouble());
+  if (changed.contains("gpuDeviceThresholds"))
+    applyGpuDeviceThresholds(settings["gpuDeviceThresholds"].toString());
+  if (changed.contains("gpuPowerMode"))
+    m_powerMonitor->setGpuPowerMode(settings["gpuPowerMode"].toString());
+  if (changed.contains("cpuMaxFrequency"))
+    m_cpuController->setMaxFrequency(settings["cpuMaxFrequency"].toDouble());
+  if (changed.contains("autoProtection"))
+    m_protector->setAutoProtection(settings["autoProtection"].toBool());
+  if (changed.contains("cooldownSeconds"))
+    m_protector->setCooldownSeconds(settings["cooldownSeconds"].toInt());
+  if (changed.contains("adaptiveCeiling"))
+    m_cpuController->setAdaptiveCeiling(settings["adaptiveCeiling"].toBool());
+  if (changed.contains("cpuHotspotThreshold"))
+    m_protector->setCpuHotspotThreshold(
+        settings["cpuHotspotThreshold"].toDouble());
+  if (changed.contains("fanTemperatureCurve"))
+    m_fanController->setTemperatureCurve(
+        settings["fanTemperatureCurve"].toString());
+  if (changed.contains("fanGpuPowerCurve"))
+    m_fanController->setGpuPowerCurve(settings["fanGpuPowerCurve"].toString());
+  if (changed.contains("fanControl"))
+    m_fanController->setEnabled(settings["fanControl"].toBool());
+  if (changed.contains("propertiesChangedInterval"))
+    m_propertyNotifier->setMinimumInterval(
+        settings["propertiesChangedInterval"].toInt());
+  if (changed.contains("telemetryChannelRateHz"))
+    m_telemetryChannel->setRateHz(settings["telemetryChannelRateHz"].toInt());
+  m_cpuController->endBatch();
+
+  return changed;
+}
+
+QMap<QString, double>
+DaemonService::parseGpuDeviceThresholds(const QString &thresholds, bool *ok) {
+  // "0000:03:00.0=250,0000:04:00.0=300"
+  QMap<QString, double> parsed;
+  *ok = true;
+
+  const QStringList entries = thresholds.split(',', Qt::SkipEmptyParts);
+  for (const QString &entry : entries) {
+    QString id = entry.section('=', 0, 0).trimmed();
+    bool valid;
+    double threshold = entry.section('=', 1).trimmed().toDouble(&valid);
+    if (id.isEmpty() || !valid || threshold < 0) {
+      *ok = false;
+      continue;
+    }
+    parsed.insert(id, threshold);
+  }
+  return parsed;
+}
+
+void DaemonService::applyGpuDeviceThresholds(const QString &thresholds) {
+  bool ok;
+  const QMap<QString, double> parsed =
+      parseGpuDeviceThresholds(thresholds, &ok);
+
+  // Devices no longer listed lose their threshold
+  const QMap<QString, double> current = m_powerMonitor->gpuDeviceThresholds();
+  for (auto it = current.begin(); it != current.end(); ++it) {
+    if (!parsed.contains(it.key())) {
+      m_powerMonitor->setGpuDeviceThreshold(it.key(), 0.0);
+    }
+  }
+  for (auto it = parsed.begin(); it != parsed.end(); ++it) {
+    m_powerMonitor->setGpuDeviceThreshold(it.key(), it.value());
+  }
+}
+
+QString DaemonService::gpuDeviceThresholds() const {
+  QStringList entries;
+  const QMap<QString, double> thresholds =
+      m_powerMonitor->gpuDeviceThresholds();
+  for (auto it = thresholds.begin(); it != thresholds.end(); ++it) {
+    entries.append(QString("%1=%2").arg(it.key()).arg(it.value()));
+  }
+  return entries.join(',');
 }
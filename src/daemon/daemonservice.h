@@ -1,49 +1,78 @@
 #pragma once
 
 #include "../cpucontroller.h"
+#include "../fancontroller.h"
+#include "../hwmonsensortable.h"
 #include "../powermonitor.h"
+#include "../proceventmonitor.h"
 #include "../systemprotector.h"
 #include "../temperaturemonitor.h"
+#include "../throttleaccounting.h"
+#include "../ueventmonitor.h"
+#include "configstore.h"
+#include "historyring.h"
+#include "processmatcher.h"
+#include "propertynotifier.h"
+#include "telemetrychannel.h"
+#include "telemetrypublisher.h"
+#include "tickscheduler.h"
 #include <QDBusAbstractAdaptor>
 #include <QDBusConnection>
+#include <QDBusContext>
+#include <QElapsedTimer>
+#include <QFileSystemWatcher>
+#include <QHash>
 #include <QObject>
+#include <QTimer>
 
-class DaemonService : public QObject {
+class DaemonService : public QObject, protected QDBusContext {
   Q_OBJECT
   Q_CLASSINFO("D-Bus Interface", "org.uncrash.Daemon")
 
-  // DBus properties
-  Q_PROPERTY(double GpuPower READ gpuPower NOTIFY GpuPowerChanged)
+  // DBus properties, changes are announced in batches through
+  // org.freedesktop.DBus.Properties.PropertiesChanged
+  Q_PROPERTY(double GpuPower READ gpuPower)
   Q_PROPERTY(double GpuPowerThreshold READ gpuPowerThreshold WRITE
-                 setGpuPowerThreshold NOTIFY GpuPowerThresholdChanged)
-  Q_PROPERTY(double CurrentMaxFrequency READ currentMaxFrequency NOTIFY
-                 CurrentMaxFrequencyChanged)
-  Q_PROPERTY(double CurrentFrequency READ currentFrequency NOTIFY
-                 CurrentFrequencyChanged)
-  Q_PROPERTY(double MaxFrequency READ maxFrequency WRITE setMaxFrequency NOTIFY
-                 MaxFrequencyChanged)
+                 setGpuPowerThreshold)
+  Q_PROPERTY(double GpuInstantPower READ gpuInstantPower)
+  Q_PROPERTY(QString GpuPowerMode READ gpuPowerMode WRITE setGpuPowerMode)
+  Q_PROPERTY(double CurrentMaxFrequency READ currentMaxFrequency)
+  Q_PROPERTY(double CurrentFrequency READ currentFrequency)
+  Q_PROPERTY(double MaxFrequency READ maxFrequency WRITE setMaxFrequency)
   Q_PROPERTY(bool RegulationEnabled READ regulationEnabled WRITE
-                 setRegulationEnabled NOTIFY RegulationEnabledChanged)
-  Q_PROPERTY(bool AutoProtection READ autoProtection WRITE setAutoProtection
-                 NOTIFY AutoProtectionChanged)
-  Q_PROPERTY(int CooldownSeconds READ cooldownSeconds WRITE setCooldownSeconds
-                 NOTIFY CooldownSecondsChanged)
-  Q_PROPERTY(bool ThresholdExceeded READ thresholdExceeded NOTIFY
-                 ThresholdExceededChanged)
-  Q_PROPERTY(
-      bool CpuLimitApplied READ cpuLimitApplied NOTIFY CpuLimitAppliedChanged)
+                 setRegulationEnabled)
+  Q_PROPERTY(bool AutoProtection READ autoProtection WRITE setAutoProtection)
+  Q_PROPERTY(int CooldownSeconds READ cooldownSeconds WRITE setCooldownSeconds)
+  Q_PROPERTY(bool ThresholdExceeded READ thresholdExceeded)
+  Q_PROPERTY(bool CpuLimitApplied READ cpuLimitApplied)
+  Q_PROPERTY(int ExternalLimitChanges READ externalLimitChanges)
+  Q_PROPERTY(bool AdaptiveCeiling READ adaptiveCeiling WRITE setAdaptiveCeiling)
+  Q_PROPERTY(double SelectedCeiling READ selectedCeiling)
+  Q_PROPERTY(QString CeilingReason READ ceilingReason)
 
   // Temperature sensors
-  Q_PROPERTY(
-      double GpuTemperature READ gpuTemperature NOTIFY GpuTemperatureChanged)
-  Q_PROPERTY(int GpuFanSpeed READ gpuFanSpeed NOTIFY GpuFanSpeedChanged)
-  Q_PROPERTY(
-      double CpuTemperature READ cpuTemperature NOTIFY CpuTemperatureChanged)
-  Q_PROPERTY(int CpuFanSpeed READ cpuFanSpeed NOTIFY CpuFanSpeedChanged)
-  Q_PROPERTY(double MotherboardTemperature READ motherboardTemperature NOTIFY
-                 MotherboardTemperatureChanged)
-  Q_PROPERTY(QString GpuVendor READ gpuVendor NOTIFY GpuVendorChanged)
-  Q_PROPERTY(QString GpuName READ gpuName NOTIFY GpuNameChanged)
+  Q_PROPERTY(double GpuTemperature READ gpuTemperature)
+  Q_PROPERTY(int GpuFanSpeed READ gpuFanSpeed)
+  Q_PROPERTY(double CpuTemperature READ cpuTemperature)
+  Q_PROPERTY(int CpuFanSpeed READ cpuFanSpeed)
+  Q_PROPERTY(double CpuHotspotTemperature READ cpuHotspotTemperature)
+  Q_PROPERTY(double CpuCoreMeanTemperature READ cpuCoreMeanTemperature)
+  Q_PROPERTY(int CpuHottestCore READ cpuHottestCore)
+  Q_PROPERTY(double CpuHotspotThreshold READ cpuHotspotThreshold WRITE
+                 setCpuHotspotThreshold)
+  Q_PROPERTY(double MotherboardTemperature READ motherboardTemperature)
+  Q_PROPERTY(QString GpuVendor READ gpuVendor)
+  Q_PROPERTY(QString GpuName READ gpuName)
+  Q_PROPERTY(QString GpuState READ gpuState)
+
+  // Fan control
+  Q_PROPERTY(bool FanControlEnabled READ fanControlEnabled WRITE
+                 setFanControlEnabled)
+  Q_PROPERTY(int FanDuty READ fanDuty)
+  Q_PROPERTY(QString FanTemperatureCurve READ fanTemperatureCurve WRITE
+                 setFanTemperatureCurve)
+  Q_PROPERTY(QString FanGpuPowerCurve READ fanGpuPowerCurve WRITE
+                 setFanGpuPowerCurve)
 
 public:
   explicit DaemonService(QObject *parent = nullptr);
@@ -51,9 +80,17 @@ public:
 
   bool registerService();
 
+  // Starts hardware probing and sampling, call after registerService()
+  void start();
+
+  // Re-reads the config and applies what changed, e.g. on SIGHUP
+  void reloadSettings(const QString &trigger);
+
   // Property getters
   double gpuPower() const;
   double gpuPowerThreshold() const;
+  double gpuInstantPower() const;
+  QString gpuPowerMode() const;
   double currentMaxFrequency() const;
   double currentFrequency() const;
   double maxFrequency() const;
@@ -62,22 +99,43 @@ public:
   int cooldownSeconds() const;
   bool thresholdExceeded() const;
   bool cpuLimitApplied() const;
+  int externalLimitChanges() const;
+  bool adaptiveCeiling() const;
+  double selectedCeiling() const;
+  QString ceilingReason() const;
 
   // Temperature getters
   double gpuTemperature() const;
   int gpuFanSpeed() const;
   double cpuTemperature() const;
   int cpuFanSpeed() const;
+  double cpuHotspotTemperature() const;
+  double cpuCoreMeanTemperature() const;
+  int cpuHottestCore() const;
+  double cpuHotspotThreshold() const;
   double motherboardTemperature() const;
   QString gpuVendor() const;
   QString gpuName() const;
+  QString gpuState() const;
+
+  // Fan control getters
+  bool fanControlEnabled() const;
+  int fanDuty() const;
+  QString fanTemperatureCurve() const;
+  QString fanGpuPowerCurve() const;
 
   // Property setters
   void setGpuPowerThreshold(double threshold);
+  void setGpuPowerMode(const QString &mode);
   void setMaxFrequency(double frequency);
   void setRegulationEnabled(bool enabled);
   void setAutoProtection(bool enabled);
   void setCooldownSeconds(int seconds);
+  void setAdaptiveCeiling(bool enabled);
+  void setCpuHotspotThreshold(double threshold);
+  void setFanControlEnabled(bool enabled);
+  void setFanTemperatureCurve(const QString &curve);
+  void setFanGpuPowerCurve(const QString &curve);
 
 public slots:
   // DBus methods
@@ -85,48 +143,141 @@ public slots:
   bool RemoveFrequencyLimit();
   QVariantMap GetStatus();
 
+  // The status only if its version differs from lastVersion, otherwise an
+  // empty map. Returns the current version.
+  qulonglong GetStatusIfChanged(qulonglong lastVersion, QVariantMap &status);
+  QVariantMap GetLimitDrift();
+
+  // Samples rejected by the sensor filters and the protection trips this
+  // avoided
+  QVariantMap GetSensorFilterStats();
+
+  // Performance cost of the frequency limit per boot and over the last
+  // hour and day
+  QVariantMap GetThrottleImpact();
+
+  // Every hwmon channel, sample values are index-aligned with the channels
+  // of the same generation
+  uint GetSensorChannels(QList<SensorChannelInfo> &channels);
+  uint GetSensorValues(QList<SensorReading> &values);
+
+  // Every GPU with its last sample and per-device power threshold
+  QList<GpuDeviceStatus> GetGpuDevices();
+  bool SetGpuDeviceThreshold(const QString &id, double threshold);
+
+  // Samples after sinceMonotonicNs (CLOCK_MONOTONIC) as packed columns,
+  // downsampled to maxPoints
+  QVariantMap GetHistory(qulonglong sinceMonotonicNs, uint maxPoints);
+
+  // Read-only fd of the shared-memory telemetry ring, see telemetryshm.h
+  QDBusUnixFileDescriptor GetTelemetryFd();
+
+  // Unicast TelemetrySample signals to the calling client at its own rate,
+  // returns the subscribed fields in sample order
+  QStringList Subscribe(double rateHz, const QStringList &fields);
+  bool Unsubscribe();
+
+  // Profiles of the [profile-<name>] config sections, active is the last
+  // activated one while the settings still match it
+  QStringList ListProfiles(QString &active);
+
+  // Validate a whole set of settings and apply it in one step, with a
+  // single write of the CPU limit and of the config. Return the changed
+  // keys.
+  QStringList ActivateProfile(const QString &name);
+  QStringList SetConfig(const QVariantMap &config);
+
 signals:
-  // DBus signals
-  void GpuPowerChanged(double power);
-  void GpuPowerThresholdChanged(double threshold);
-  void CurrentMaxFrequencyChanged(double frequency);
-  void CurrentFrequencyChanged(double frequency);
-  void MaxFrequencyChanged(double frequency);
-  void RegulationEnabledChanged(bool enabled);
-  void AutoProtectionChanged(bool enabled);
-  void CooldownSecondsChanged(int seconds);
-  void ThresholdExceededChanged(bool exceeded);
-  void CpuLimitAppliedChanged(bool applied);
+  // DBus signals, property changes go out as PropertiesChanged
   void FrequencyLimitApplied(double frequency);
   void FrequencyLimitRemoved();
 
-  // Temperature signals
-  void GpuTemperatureChanged(double temperature);
-  void GpuFanSpeedChanged(int speed);
-  void CpuTemperatureChanged(double temperature);
-  void CpuFanSpeedChanged(int speed);
-  void MotherboardTemperatureChanged(double temperature);
-  void GpuVendorChanged(const QString &vendor);
-  void GpuNameChanged(const QString &name);
+  // Sensor table signals
+  void SensorTableChanged(uint generation);
+
+  // GPU signals
+  void GpuDevicesChanged();
+
+  // Result of a config reload, changed holds the applied keys
+  void ConfigReloaded(bool success, const QStringList &changed,
+                      const QString &error);
 
 private slots:
-  void onGpuPowerChanged();
-  void onGpuPowerThresholdChanged();
-  void onCurrentMaxFrequencyChanged();
-  void onCurrentFrequencyChanged();
-  void onMaxFrequencyChanged();
-  void onRegulationEnabledChanged();
-  void onAutoProtectionChanged();
-  void onCooldownSecondsChanged();
-  void onThresholdExceededChanged();
-  void onCpuLimitAppliedChanged();
+  void updateFans();
+  void onGpuDevicesChanged();
+  void updatePeakSampling();
+  void onSensorBindingsChanged();
+  void onUevent(const Uevent &event);
+  void onReloadTimeout();
+  void onProcessExecuted(int pid);
+  void onProcessExited(int pid);
 
 private:
+  struct Profile {
+    QVariantMap settings;
+    QStringList processes; // Executable patterns that activate the profile
+  };
+
   void loadSettings();
   void saveSettings();
+  QVariantMap currentSettings() const;
+  QVariantMap settingDefaults() const;
+  static QString settingText(const QVariant &raw);
+  bool parseSetting(const QString &key, const QString &text,
+                    QVariant *value) const;
+  void readSettings(QVariantMap *settings, QMap<QString, Profile> *profiles,
+                    QStringList *errors) const;
+  QStringList applySettings(const QVariantMap &settings);
+  static QMap<QString, double>
+  parseGpuDeviceThresholds(const QString &thresholds, bool *ok);
+  void applyGpuDeviceThresholds(const QString &thresholds);
+  QString gpuDeviceThresholds() const;
+  void addTelemetryFields();
+  void updateProcessRules();
+  void scanProcesses();
+  void matchProcess(int pid);
+  void updateProcessProfile();
+  QVariantMap withProcessProfile(QVariantMap settings, const QString &name);
+  const QVariantMap &statusSnapshot();
+  QVariantMap buildStatus() const;
+  void addStatusCounters(QVariantMap *status) const;
 
   SystemProtector *m_protector;
   PowerMonitor *m_powerMonitor;
   CpuController *m_cpuController;
   TemperatureMonitor *m_temperatureMonitor;
+  FanController *m_fanController;
+  TickScheduler *m_scheduler;
+  UeventMonitor *m_ueventMonitor;
+  HwmonSensorTable *m_sensorTable;
+  ThrottleAccounting *m_throttleAccounting;
+  PropertyNotifier *m_propertyNotifier;
+  TelemetryPublisher *m_telemetry;
+  TelemetryChannel *m_telemetryChannel;
+  ConfigStore *m_configStore;
+  QVariantMap m_storedSettings; // What the file has, or will have
+  QFileSystemWatcher *m_configWatcher;
+  QTimer *m_reloadTimer;
+  QString m_reloadTrigger;
+  QMap<QString, Profile> m_profiles;
+  QString m_activeProfile;
+
+  // Profiles switched by running processes, the most recently started
+  // matching process wins
+  ProcEventMonitor *m_procEventMonitor;
+  ProcessMatcher m_processMatcher;
+  QHash<int, QString> m_processProfiles; // Profile by pid
+  QStringList m_processProfileOrder;     // Least recently matched first
+  QString m_processProfile;
+  QVariantMap m_processRestore; // Values the process profile replaced
+  HistoryRing m_history;
+
+  QVariantMap m_status;
+  qulonglong m_statusVersion = 0;
+  bool m_statusStale = true;
+
+  QElapsedTimer m_startupClock;
+  bool m_gpuPowerSourceRegistered = false;
+  bool m_peakPowerSourceRegistered = false;
+  bool m_protectionStarted = false;
 };
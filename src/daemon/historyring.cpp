@@ -0,0 +1,100 @@
+#include "historyring.h"
+#include <algorithm>
+#include <ctime>
+#include <limits>
+
+HistoryRing::HistoryRing(int capacity)
+    : m_timestamps(std::max(capacity, 1), 0) {}
+
+void HistoryRing::addColumn(const QString &name, Aggregate aggregate,
+                            std::function<double()> read) {
+  Column column;
+  column.name = name;
+  column.aggregate = aggregate;
+  column.read = std::move(read);
+  column.values.resize(m_timestamps.size(), 0.0f);
+  m_columns.append(std::move(column));
+}
+
+void HistoryRing::sample(quint64 timestampNs) {
+  m_timestamps[m_next] = timestampNs;
+  for (Column &column : m_columns) {
+    column.values[m_next] = float(column.read());
+  }
+
+  m_next = (m_next + 1) % capacity();
+  m_size = std::min(m_size + 1, capacity());
+}
+
+int HistoryRing::at(int i) const {
+  return (m_next - m_size + i + capacity()) % capacity();
+}
+
+QVariantMap HistoryRing::history(quint64 sinceNs, int maxPoints) const {
+  // Timestamps are monotonic, binary search the first one after sinceNs
+  int low = 0;
+  int high = m_size;
+  while (low < high) {
+    int middle = (low + high) / 2;
+    if (m_timestamps[at(middle)] > sinceNs) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+
+  int first = low;
+  int count = m_size - first;
+  int points = maxPoints > 0 ? std::min(count, maxPoints) : count;
+
+  QList<qulonglong> timestamps;
+  timestamps.reserve(points);
+  QList<QList<double>> columns(m_columns.size());
+  for (QList<double> &values : columns) {
+    values.reserve(points);
+  }
+
+  for (int bucket = 0; bucket < points; bucket++) {
+    int begin = first + qint64(bucket) * count / points;
+    int end = first + qint64(bucket + 1) * count / points;
+    timestamps.append(m_timestamps[at(end - 1)]);
+
+    for (int c = 0; c < m_columns.size(); c++) {
+      const Column &column = m_columns[c];
+      double sum = 0.0;
+      double minimum = std::numeric_limits<double>::max();
+      double maximum = std::numeric_limits<double>::lowest();
+      for (int i = begin; i < end; i++) {
+        double value = column.values[at(i)];
+        sum += value;
+        minimum = std::min(minimum, value);
+        maximum = std::max(maximum, value);
+      }
+
+      switch (column.aggregate) {
+      case Aggregate::Mean:
+        columns[c].append(sum / (end - begin));
+        break;
+      case Aggregate::Min:
+        columns[c].append(minimum);
+        break;
+      case Aggregate::Max:
+        columns[c].append(maximum);
+        break;
+      }
+    }
+  }
+
+  QVariantMap history;
+  history["timestamps"] = QVariant::fromValue(timestamps);
+  for (int c = 0; c < m_columns.size(); c++) {
+    history[m_columns[c].name] = QVariant::fromValue(columns[c]);
+  }
+  return history;
+}
+
+quint64 HistoryRing::monotonicNs() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return quint64(now.tv_sec) * 1000000000ull + quint64(now.tv_nsec);
+}
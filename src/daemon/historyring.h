@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QList>
+#include <QString>
+#include <QVariantMap>
+#include <functional>
+#include <vector>
+
+// Fixed-memory ring of timestamped samples, one column per value. All memory
+// is allocated when the columns are added, a full ring overwrites its oldest
+// sample.
+//
+// Timestamps are CLOCK_MONOTONIC nanoseconds, so clients can compare them
+// with their own clock and ask for everything after the last sample they
+// have.
+class HistoryRing {
+public:
+  // How samples are merged when the history is downsampled
+  enum class Aggregate {
+    Mean,
+    Min, // E.g. frequency ceilings, where the dips matter
+    Max  // E.g. power and temperatures, where the peaks matter
+  };
+
+  explicit HistoryRing(int capacity);
+
+  // Columns must be added before the first sample
+  void addColumn(const QString &name, Aggregate aggregate,
+                 std::function<double()> read);
+
+  // Reads every column
+  void sample(quint64 timestampNs);
+
+  // Samples newer than sinceNs as "timestamps" (at) and one ad per column.
+  // Above maxPoints the samples are merged into maxPoints buckets, each
+  // stamped with the time of its newest sample. 0 returns every sample.
+  QVariantMap history(quint64 sinceNs, int maxPoints) const;
+
+  int size() const { return m_size; }
+  int capacity() const { return int(m_timestamps.size()); }
+
+  static quint64 monotonicNs();
+
+private:
+  struct Column {
+    QString name;
+    Aggregate aggregate;
+    std::function<double()> read;
+    std::vector<float> values; // float halves the memory, plenty for sensors
+  };
+
+  // Ring index of the i-th oldest sample
+  int at(int i) const;
+
+  std::vector<quint64> m_timestamps;
+  QList<Column> m_columns;
+  int m_next = 0; // Ring index of the next sample
+  int m_size = 0;
+};
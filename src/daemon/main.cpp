@@ -1,11 +1,24 @@
 #include "daemonservice.h"
 #include <QCoreApplication>
 #include <QDebug>
+#include <QSocketNotifier>
 #include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
 
 static QCoreApplication *app = nullptr;
 
+// SIGHUP is passed to the event loop through a pipe, nothing else is safe
+// to do in a signal handler
+static int hangupPipe[2] = {-1, -1};
+
 void signalHandler(int signal) {
+  if (signal == SIGHUP) {
+    char byte = 1;
+    [[maybe_unused]] ssize_t written = ::write(hangupPipe[1], &byte, 1);
+    return;
+  }
+
   if (signal == SIGTERM || signal == SIGINT) {
     qInfo() << "Received signal" << signal << ", shutting down...";
     if (app) {
@@ -14,6 +27,12 @@ void signalHandler(int signal) {
   }
 }
 
+static void drainHangupPipe() {
+  char buffer[16];
+  while (::read(hangupPipe[0], buffer, sizeof(buffer)) > 0) {
+  }
+}
+
 int main(int argc, char *argv[]) {
   QCoreApplication application(argc, argv);
   app = &application;
@@ -22,17 +41,36 @@ int main(int argc, char *argv[]) {
   QCoreApplication::setApplicationName("uncrashd");
   QCoreApplication::setApplicationVersion("0.0.1");
 
-  // Set up signal handlers
+  // Set up signal handlers. SIGHUP's default action terminates, so it is
+  // caught before the service exists and a reload during startup stays in
+  // the pipe until the service reads it.
   std::signal(SIGTERM, signalHandler);
   std::signal(SIGINT, signalHandler);
+  bool hangupPipeOpen = ::pipe2(hangupPipe, O_CLOEXEC | O_NONBLOCK) == 0;
+  if (hangupPipeOpen) {
+    std::signal(SIGHUP, signalHandler);
+  }
 
   qInfo() << "Starting Uncrash daemon...";
 
+  // Take the DBus name first, hardware probing happens in the background
   DaemonService service;
   if (!service.registerService()) {
     qCritical() << "Failed to register DBus service, exiting.";
     return 1;
   }
+  service.start();
+
+  // Reload the config on SIGHUP
+  if (hangupPipeOpen) {
+    auto *hangupNotifier = new QSocketNotifier(
+        hangupPipe[0], QSocketNotifier::Read, &application);
+    QObject::connect(hangupNotifier, &QSocketNotifier::activated, &service,
+                     [&service]() {
+                       drainHangupPipe();
+                       service.reloadSettings("SIGHUP");
+                     });
+  }
 
   qInfo() << "Uncrash daemon started successfully";
 
@@ -0,0 +1,62 @@
+#include "processmatcher.h"
+#include <QDebug>
+
+void ProcessMatcher::setRules(const QList<Rule> &rules) {
+  m_rules = rules;
+  m_profiles.clear();
+
+  QStringList alternatives;
+  for (const Rule &rule : rules) {
+    if (rule.pattern.isEmpty()) {
+      continue;
+    }
+    alternatives.append('(' + globToRegularExpression(rule.pattern) + ')');
+    m_profiles.append(rule.profile);
+  }
+
+  if (alternatives.isEmpty()) {
+    m_expression = QRegularExpression();
+    return;
+  }
+
+  m_expression = QRegularExpression("\\A(?:" + alternatives.join('|') +
+                                    ")\\z");
+  m_expression.optimize();
+  if (!m_expression.isValid()) {
+    qWarning() << "Invalid process patterns:" << m_expression.errorString();
+    m_profiles.clear();
+  }
+}
+
+QString ProcessMatcher::match(const QString &executable) const {
+  if (m_profiles.isEmpty()) {
+    return QString();
+  }
+
+  // Only the groups of one alternative capture, the highest one is it. The
+  // leftmost alternative wins, so earlier rules take precedence.
+  QRegularExpressionMatch result = m_expression.match(executable);
+  if (!result.hasMatch()) {
+    return QString();
+  }
+  return m_profiles.value(result.lastCapturedIndex() - 1);
+}
+
+QString ProcessMatcher::globToRegularExpression(const QString &pattern) {
+  bool path = pattern.contains('/');
+  QString any = path ? ".*" : "[^/]*";
+  QString one = path ? "." : "[^/]";
+
+  // File name patterns match in any directory
+  QString expression = path ? QString() : QString("(?:.*/)?");
+  for (QChar c : pattern) {
+    if (c == '*') {
+      expression += any;
+    } else if (c == '?') {
+      expression += one;
+    } else {
+      expression += QRegularExpression::escape(QString(c));
+    }
+  }
+  return expression;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QList>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+
+// Maps executable paths to profiles by glob patterns. All patterns are
+// compiled into one regular expression with a capture group per pattern, so
+// an exec event costs a single match however many rules there are.
+//
+// Patterns without a '/' match the file name ("blender*"), patterns with
+// one the whole path ("/opt/*/bin/houdini"). '*' and '?' don't match '/'
+// in file names, they do in paths.
+class ProcessMatcher {
+public:
+  struct Rule {
+    QString pattern;
+    QString profile;
+
+    bool operator==(const Rule &other) const {
+      return pattern == other.pattern && profile == other.profile;
+    }
+  };
+
+  void setRules(const QList<Rule> &rules);
+  const QList<Rule> &rules() const { return m_rules; }
+  bool isEmpty() const { return m_profiles.isEmpty(); }
+
+  // Profile of the first matching rule, empty if none matches
+  QString match(const QString &executable) const;
+
+  static QString globToRegularExpression(const QString &pattern);
+
+private:
+  QList<Rule> m_rules;
+  QRegularExpression m_expression;
+  QStringList m_profiles; // By capture group - 1
+};
@@ -0,0 +1,67 @@
+#include "propertynotifier.h"
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDebug>
+#include <QStringList>
+
+PropertyNotifier::PropertyNotifier(QObject *object, const QString &path,
+                                   const QString &interface, QObject *parent)
+    : QObject(parent), m_object(object), m_path(path), m_interface(interface),
+      m_timer(new QTimer(this)) {
+  m_timer->setSingleShot(true);
+  connect(m_timer, &QTimer::timeout, this, &PropertyNotifier::flush);
+}
+
+void PropertyNotifier::setMinimumInterval(int ms) {
+  m_minimumIntervalMs = qMax(0, ms);
+}
+
+void PropertyNotifier::markChanged(const char *property) {
+  m_dirty.insert(property);
+  emit changed();
+  if (!m_timer->isActive()) {
+    scheduleFlush();
+  }
+}
+
+void PropertyNotifier::scheduleFlush() {
+  // A zero timeout fires once the current tick has finished
+  qint64 wait = 0;
+  if (m_sinceEmit.isValid()) {
+    wait = qMax<qint64>(0, m_minimumIntervalMs - m_sinceEmit.elapsed());
+  }
+  m_timer->start(static_cast<int>(wait));
+}
+
+void PropertyNotifier::flush() {
+  QVariantMap changed;
+  for (const QByteArray &property : std::as_const(m_dirty)) {
+    QString name = QString::fromLatin1(property);
+    QVariant value = m_object->property(property.constData());
+
+    // Skip values that changed and changed back, or were only re-set
+    auto last = m_lastEmitted.constFind(name);
+    if (last != m_lastEmitted.constEnd() && last.value() == value) {
+      continue;
+    }
+
+    changed.insert(name, value);
+    m_lastEmitted.insert(name, value);
+  }
+  m_dirty.clear();
+
+  if (changed.isEmpty()) {
+    return;
+  }
+
+  QDBusMessage signal = QDBusMessage::createSignal(
+      m_path, "org.freedesktop.DBus.Properties", "PropertiesChanged");
+  signal << m_interface << changed << QStringList();
+
+  if (!QDBusConnection::systemBus().send(signal)) {
+    qWarning() << "Failed to send PropertiesChanged for" << changed.keys();
+  }
+
+  m_emittedSignals++;
+  m_sinceEmit.start();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+#include <QVariantMap>
+
+// Coalesces the property changes of a DBus object into standard
+// org.freedesktop.DBus.Properties.PropertiesChanged signals holding only the
+// keys whose values differ from the last emitted ones.
+//
+// A scheduler tick runs all of its sources in one pass of the event loop, so
+// everything that changed during a tick goes out in a single message. Signals
+// are at least the minimum interval apart, changes in between are merged
+// into the next one.
+class PropertyNotifier : public QObject {
+  Q_OBJECT
+
+public:
+  // object is read through its Qt properties, whose names are the DBus
+  // property names
+  PropertyNotifier(QObject *object, const QString &path,
+                   const QString &interface, QObject *parent = nullptr);
+
+  int minimumInterval() const { return m_minimumIntervalMs; }
+  void setMinimumInterval(int ms);
+
+  // Marks a property for the next signal, its value is read when it is sent
+  void markChanged(const char *property);
+
+  quint64 emittedSignals() const { return m_emittedSignals; }
+
+signals:
+  // Right away on every markChanged(), for state derived from the properties
+  void changed();
+
+private slots:
+  void flush();
+
+private:
+  void scheduleFlush();
+
+  QObject *m_object;
+  QString m_path;
+  QString m_interface;
+
+  QSet<QByteArray> m_dirty;
+  QVariantMap m_lastEmitted;
+  QTimer *m_timer;
+  QElapsedTimer m_sinceEmit;
+  int m_minimumIntervalMs = 0;
+  quint64 m_emittedSignals = 0;
+};
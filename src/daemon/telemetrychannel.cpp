@@ -0,0 +1,208 @@
+#include "telemetrychannel.h"
+#include "historyring.h"
+#include <QDBusConnection>
+#include <QDebug>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Linux 5.1, older libc headers lack it
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE 0x0010
+#endif
+
+namespace {
+// At least 10 s at the default rate
+constexpr uint32_t kRecords = 1024;
+constexpr uint32_t kHeaderSize = 4096;
+} // namespace
+
+static_assert(sizeof(uncrash::TelemetryShmHeader) <= kHeaderSize,
+              "Telemetry header does not fit its page");
+
+TelemetryChannel::TelemetryChannel(TickScheduler *scheduler, QObject *parent)
+    : QObject(parent), m_scheduler(scheduler),
+      m_watcher(new QDBusServiceWatcher(this)) {
+  m_watcher->setConnection(QDBusConnection::systemBus());
+  m_watcher->setWatchMode(QDBusServiceWatcher::WatchForUnregistration);
+  connect(m_watcher, &QDBusServiceWatcher::serviceUnregistered, this,
+          &TelemetryChannel::onServiceUnregistered);
+}
+
+TelemetryChannel::~TelemetryChannel() {
+  if (m_memory != nullptr) {
+    ::munmap(m_memory, m_size);
+  }
+  if (m_fd >= 0) {
+    ::close(m_fd);
+  }
+}
+
+void TelemetryChannel::addField(const QString &name,
+                                std::function<double()> read) {
+  if (m_fields.size() >= uncrash::kTelemetryShmMaxFields) {
+    qWarning() << "Telemetry channel is full, not adding" << name;
+    return;
+  }
+  m_fields.append({name, std::move(read)});
+}
+
+void TelemetryChannel::setRateHz(int rateHz) {
+  m_rateHz = std::clamp(rateHz, 1, 1000);
+  if (m_header != nullptr) {
+    m_header->rateHz = uint32_t(m_rateHz);
+  }
+}
+
+QDBusUnixFileDescriptor TelemetryChannel::open(const QString &client) {
+  if (m_fd < 0 && !create()) {
+    return QDBusUnixFileDescriptor();
+  }
+
+  // A separate read-only open file description. It doesn't stop a client
+  // from reopening the memfd writable through /proc, the write seal does.
+  QString path = QString("/proc/self/fd/%1").arg(m_fd);
+  int fd = ::open(path.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    qWarning() << "Failed to reopen the telemetry channel read-only:"
+               << strerror(errno);
+    return QDBusUnixFileDescriptor();
+  }
+
+  if (!m_readers.contains(client)) {
+    m_readers.insert(client);
+    m_watcher->addWatchedService(client);
+    qInfo() << "Telemetry channel reader" << client;
+    updateSource();
+  }
+
+  QDBusUnixFileDescriptor descriptor;
+  descriptor.giveFileDescriptor(fd);
+  return descriptor;
+}
+
+void TelemetryChannel::onServiceUnregistered(const QString &client) {
+  if (m_readers.remove(client)) {
+    m_watcher->removeWatchedService(client);
+    qInfo() << "Telemetry channel reader" << client << "left";
+    updateSource();
+  }
+}
+
+bool TelemetryChannel::create() {
+  m_size = kHeaderSize + size_t(kRecords) * sizeof(uncrash::TelemetryShmRecord);
+
+  m_fd = ::memfd_create("uncrash-telemetry", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (m_fd < 0) {
+    qWarning() << "Failed to create the telemetry channel:" << strerror(errno);
+    return false;
+  }
+
+  if (::ftruncate(m_fd, off_t(m_size)) != 0) {
+    qWarning() << "Failed to size the telemetry channel:" << strerror(errno);
+    ::close(m_fd);
+    m_fd = -1;
+    return false;
+  }
+
+  m_memory =
+      ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+  if (m_memory == MAP_FAILED) {
+    qWarning() << "Failed to map the telemetry channel:" << strerror(errno);
+    m_memory = nullptr;
+    ::close(m_fd);
+    m_fd = -1;
+    return false;
+  }
+
+  // memfd inodes are mode 0777, any local user could reopen a client fd
+  // O_RDWR and corrupt the ring every reader trusts. Only the mapping above
+  // stays writable after F_SEAL_FUTURE_WRITE, readers rely on the size they
+  // mapped.
+  if (::fcntl(m_fd, F_ADD_SEALS,
+              F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_FUTURE_WRITE |
+                  F_SEAL_SEAL) != 0) {
+    qWarning() << "Failed to seal the telemetry channel:" << strerror(errno);
+    ::munmap(m_memory, m_size);
+    m_memory = nullptr;
+    ::close(m_fd);
+    m_fd = -1;
+    return false;
+  }
+
+  // memfd pages start zeroed, so every sequence reads as never written
+  m_header = new (m_memory) uncrash::TelemetryShmHeader();
+  m_header->magic = uncrash::kTelemetryShmMagic;
+  m_header->version = uncrash::kTelemetryShmVersion;
+  m_header->headerSize = kHeaderSize;
+  m_header->recordSize = sizeof(uncrash::TelemetryShmRecord);
+  m_header->capacity = kRecords;
+  m_header->fieldCount = uint32_t(m_fields.size());
+  m_header->rateHz = uint32_t(m_rateHz);
+  for (int i = 0; i < m_fields.size(); i++) {
+    QByteArray name = m_fields[i].name.toLatin1();
+    std::strncpy(m_header->fieldNames[i], name.constData(),
+                 uncrash::kTelemetryShmFieldNameSize - 1);
+  }
+  m_header->writeIndex.store(0, std::memory_order_release);
+
+  m_records = reinterpret_cast<uncrash::TelemetryShmRecord *>(
+      static_cast<char *>(m_memory) + kHeaderSize);
+
+  qInfo() << "Telemetry channel created," << m_size / 1024 << "KiB";
+  return true;
+}
+
+void TelemetryChannel::updateSource() {
+  bool wanted = !m_readers.isEmpty();
+  if (wanted == bool(m_tickConnection)) {
+    return;
+  }
+
+  // A source of its own would copy the same values again between samples
+  // and wake the daemon for nothing, after a tick at least one field may
+  // have changed
+  if (wanted) {
+    m_tickConnection =
+        connect(m_scheduler, &TickScheduler::tickFinished, this,
+                &TelemetryChannel::onTickFinished);
+  } else {
+    disconnect(m_tickConnection);
+    m_tickConnection = QMetaObject::Connection();
+  }
+}
+
+void TelemetryChannel::onTickFinished() {
+  // Ticks drift by a few ms, only skip those well inside the interval
+  quint64 nowNs = HistoryRing::monotonicNs();
+  quint64 minIntervalNs = 750000000ull / quint64(m_rateHz);
+  if (m_lastWriteNs != 0 && nowNs - m_lastWriteNs < minIntervalNs) {
+    return;
+  }
+
+  m_lastWriteNs = nowNs;
+  write();
+}
+
+void TelemetryChannel::write() {
+  uncrash::TelemetryShmRecord &record = m_records[m_writeIndex % kRecords];
+
+  // Odd while writing, readers discard what they copied meanwhile
+  record.sequence.store(uint32_t(2 * m_writeIndex + 1),
+                        std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  record.timestampNs = HistoryRing::monotonicNs();
+  for (int i = 0; i < m_fields.size(); i++) {
+    record.values[i] = m_fields[i].read();
+  }
+
+  record.sequence.store(uint32_t(2 * (m_writeIndex + 1)),
+                        std::memory_order_release);
+  m_writeIndex++;
+  m_header->writeIndex.store(m_writeIndex, std::memory_order_release);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "../telemetryshm.h"
+#include "tickscheduler.h"
+#include <QDBusServiceWatcher>
+#include <QDBusUnixFileDescriptor>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <functional>
+
+// Writes telemetry records into a memfd-backed ring (see telemetryshm.h)
+// that local readers mmap and poll without any per-sample IPC.
+//
+// The ring is created on the first open(). While a client that fetched the
+// fd is on the bus a record is written after every scheduler tick, i.e.
+// whenever a sampling source ran, at most rateHz times per second. Clients
+// only get a read-only fd.
+class TelemetryChannel : public QObject {
+  Q_OBJECT
+
+public:
+  TelemetryChannel(TickScheduler *scheduler, QObject *parent = nullptr);
+  ~TelemetryChannel() override;
+
+  // Fields beyond kTelemetryShmMaxFields are ignored, fields must be added
+  // before the first open()
+  void addField(const QString &name, std::function<double()> read);
+
+  int rateHz() const { return m_rateHz; }
+  void setRateHz(int rateHz);
+
+  // A read-only fd of the ring for client, invalid on errors
+  QDBusUnixFileDescriptor open(const QString &client);
+
+  int readerCount() const { return m_readers.size(); }
+  quint64 writtenRecords() const { return m_writeIndex; }
+
+private slots:
+  void onServiceUnregistered(const QString &client);
+
+private:
+  struct Field {
+    QString name;
+    std::function<double()> read;
+  };
+
+  bool create();
+  void onTickFinished();
+  void write();
+  void updateSource();
+
+  TickScheduler *m_scheduler;
+  QDBusServiceWatcher *m_watcher;
+  QList<Field> m_fields;
+  QSet<QString> m_readers;
+  int m_rateHz = 100;
+  QMetaObject::Connection m_tickConnection;
+  quint64 m_lastWriteNs = 0;
+
+  int m_fd = -1;
+  void *m_memory = nullptr;
+  size_t m_size = 0;
+  uncrash::TelemetryShmHeader *m_header = nullptr;
+  uncrash::TelemetryShmRecord *m_records = nullptr;
+  quint64 m_writeIndex = 0;
+};
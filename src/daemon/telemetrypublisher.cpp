@@ -0,0 +1,181 @@
+#include "telemetrypublisher.h"
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDateTime>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace {
+// 20 Hz matches the fastest sampling in the daemon, the peak power sampler
+constexpr double kMinRateHz = 0.1;
+constexpr double kMaxRateHz = 20.0;
+
+// NaN marks unavailable sensors and has to compare equal to itself
+bool sameSample(const QList<double> &a, const QList<double> &b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (int i = 0; i < a.size(); i++) {
+    if (a[i] != b[i] && !(std::isnan(a[i]) && std::isnan(b[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+TelemetryPublisher::TelemetryPublisher(TickScheduler *scheduler,
+                                       const QString &path,
+                                       const QString &interface,
+                                       QObject *parent)
+    : QObject(parent), m_scheduler(scheduler), m_path(path),
+      m_interface(interface), m_watcher(new QDBusServiceWatcher(this)) {
+  m_watcher->setConnection(QDBusConnection::systemBus());
+  m_watcher->setWatchMode(QDBusServiceWatcher::WatchForUnregistration);
+  connect(m_watcher, &QDBusServiceWatcher::serviceUnregistered, this,
+          &TelemetryPublisher::onServiceUnregistered);
+
+  m_clock.start();
+}
+
+void TelemetryPublisher::addField(const QString &name,
+                                  std::function<double()> read) {
+  m_fields.append({name, std::move(read)});
+}
+
+QStringList TelemetryPublisher::fields() const {
+  QStringList names;
+  for (const Field &field : m_fields) {
+    names.append(field.name);
+  }
+  return names;
+}
+
+QStringList TelemetryPublisher::subscribe(const QString &client,
+                                          double rateHz,
+                                          const QStringList &fields,
+                                          QString *error) {
+  Subscriber subscriber;
+  QStringList subscribed = fields.isEmpty() ? this->fields() : fields;
+  for (const QString &name : std::as_const(subscribed)) {
+    auto it = std::find_if(
+        m_fields.begin(), m_fields.end(),
+        [&name](const Field &field) { return field.name == name; });
+    if (it == m_fields.end()) {
+      *error = QString("Unknown telemetry field %1").arg(name);
+      return QStringList();
+    }
+    subscriber.fields.append(int(it - m_fields.begin()));
+  }
+
+  if (!std::isfinite(rateHz)) {
+    rateHz = kMinRateHz;
+  }
+  rateHz = std::clamp(rateHz, kMinRateHz, kMaxRateHz);
+  subscriber.intervalMs = int(std::lround(1000.0 / rateHz));
+
+  // The first sample goes out on the next tick
+  subscriber.nextDueMs = m_clock.elapsed();
+
+  if (!m_subscribers.contains(client)) {
+    m_watcher->addWatchedService(client);
+  }
+  m_subscribers.insert(client, subscriber);
+
+  qInfo() << "Telemetry subscriber" << client << "at" << rateHz << "Hz:"
+          << subscribed;
+  updateSource();
+  return subscribed;
+}
+
+bool TelemetryPublisher::unsubscribe(const QString &client) {
+  if (!m_subscribers.remove(client)) {
+    return false;
+  }
+
+  m_watcher->removeWatchedService(client);
+  qInfo() << "Telemetry subscriber" << client << "left";
+  updateSource();
+  return true;
+}
+
+void TelemetryPublisher::onServiceUnregistered(const QString &client) {
+  // Clients that exit or crash without unsubscribing
+  unsubscribe(client);
+}
+
+void TelemetryPublisher::updateSource() {
+  // One source at the fastest requested rate serves every subscriber
+  int periodMs = 0;
+  for (const Subscriber &subscriber : std::as_const(m_subscribers)) {
+    if (periodMs == 0 || subscriber.intervalMs < periodMs) {
+      periodMs = subscriber.intervalMs;
+    }
+  }
+
+  if (periodMs == m_sourcePeriodMs) {
+    return;
+  }
+
+  if (periodMs == 0) {
+    m_scheduler->unregisterSource("telemetry");
+  } else if (m_sourcePeriodMs == 0) {
+    m_scheduler->registerSource("telemetry", periodMs,
+                                TickScheduler::Priority::Normal,
+                                [this]() { publish(); });
+  } else {
+    m_scheduler->setSourcePeriod("telemetry", periodMs);
+  }
+  m_sourcePeriodMs = periodMs;
+}
+
+void TelemetryPublisher::publish() {
+  qint64 now = m_clock.elapsed();
+  qint64 timestamp = QDateTime::currentMSecsSinceEpoch();
+  QDBusConnection bus = QDBusConnection::systemBus();
+
+  // Every field is read at most once per tick, however many subscribers
+  // want it
+  std::vector<double> values(m_fields.size(),
+                             std::numeric_limits<double>::quiet_NaN());
+  std::vector<bool> read(m_fields.size(), false);
+
+  for (auto it = m_subscribers.begin(); it != m_subscribers.end(); ++it) {
+    Subscriber &subscriber = it.value();
+
+    // Slower subscribers ride along the ticks of the fastest one
+    if (subscriber.nextDueMs - m_sourcePeriodMs / 2 > now) {
+      continue;
+    }
+    subscriber.nextDueMs += subscriber.intervalMs;
+    if (subscriber.nextDueMs <= now) {
+      subscriber.nextDueMs = now + subscriber.intervalMs;
+    }
+
+    QList<double> sample;
+    sample.reserve(subscriber.fields.size());
+    for (int index : std::as_const(subscriber.fields)) {
+      if (!read[index]) {
+        values[index] = m_fields[index].read();
+        read[index] = true;
+      }
+      sample.append(values[index]);
+    }
+
+    if (sameSample(sample, subscriber.lastSample)) {
+      m_skippedSamples++;
+      continue;
+    }
+    subscriber.lastSample = sample;
+
+    QDBusMessage signal = QDBusMessage::createTargetedSignal(
+        it.key(), m_path, m_interface, "TelemetrySample");
+    signal << timestamp << QVariant::fromValue(sample);
+    if (bus.send(signal)) {
+      m_sentSamples++;
+    }
+  }
+}
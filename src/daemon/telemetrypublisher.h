@@ -0,0 +1,75 @@
+#pragma once
+
+#include "tickscheduler.h"
+#include <QDBusServiceWatcher>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+// Sends telemetry to the DBus clients that subscribed to it, each at its own
+// rate and with only its own fields. Samples are packed into one unicast
+// TelemetrySample(x timestamp, ad values) signal per client and interval,
+// values index-aligned with the fields returned by subscribe(). Samples
+// that equal the last one sent to the client are skipped, most fields only
+// change at the period of their sensor.
+//
+// Subscribers are tracked by unique bus name and dropped when they leave the
+// bus. Without subscribers the tick source is unregistered and nothing is
+// read or encoded.
+class TelemetryPublisher : public QObject {
+  Q_OBJECT
+
+public:
+  TelemetryPublisher(TickScheduler *scheduler, const QString &path,
+                     const QString &interface, QObject *parent = nullptr);
+
+  void addField(const QString &name, std::function<double()> read);
+  QStringList fields() const;
+
+  // Replaces an earlier subscription of the client, no fields subscribe to
+  // all of them. The rate is clamped to 0.1–20 Hz. Returns the subscribed
+  // fields in sample order, or an empty list and the error for unknown
+  // fields.
+  QStringList subscribe(const QString &client, double rateHz,
+                        const QStringList &fields, QString *error);
+  bool unsubscribe(const QString &client);
+
+  int subscriberCount() const { return m_subscribers.size(); }
+  quint64 sentSamples() const { return m_sentSamples; }
+  quint64 skippedSamples() const { return m_skippedSamples; }
+
+private slots:
+  void onServiceUnregistered(const QString &client);
+
+private:
+  struct Field {
+    QString name;
+    std::function<double()> read;
+  };
+
+  struct Subscriber {
+    QList<int> fields; // Indexes into m_fields
+    int intervalMs = 1000;
+    qint64 nextDueMs = 0;
+    QList<double> lastSample; // Empty until the first sample was sent
+  };
+
+  void publish();
+  void updateSource();
+
+  TickScheduler *m_scheduler;
+  QString m_path;
+  QString m_interface;
+  QDBusServiceWatcher *m_watcher;
+
+  QList<Field> m_fields;
+  QHash<QString, Subscriber> m_subscribers;
+  QElapsedTimer m_clock;
+  int m_sourcePeriodMs = 0; // 0 while the tick source is unregistered
+  quint64 m_sentSamples = 0;
+  quint64 m_skippedSamples = 0;
+};
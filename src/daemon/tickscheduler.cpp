@@ -0,0 +1,157 @@
+#include "tickscheduler.h"
+#include <QDebug>
+#include <algorithm>
+#include <limits>
+
+TickScheduler::TickScheduler(QObject *parent)
+    : QObject(parent), m_timer(new QTimer(this)) {
+  m_timer->setSingleShot(true);
+  connect(m_timer, &QTimer::timeout, this, &TickScheduler::onTimeout);
+}
+
+void TickScheduler::registerSource(const QString &name, int periodMs,
+                                   Priority priority,
+                                   std::function<void()> callback) {
+  Source source;
+  source.name = name;
+  source.periodMs = qMax(1, periodMs);
+  source.priority = priority;
+  source.callback = std::move(callback);
+
+  // Align to the common epoch, the source runs on the next wakeup
+  source.nextDueMs = m_clock.isValid() ? m_clock.elapsed() : 0;
+
+  // Keep critical sources first, so they run before anything else in a tick
+  auto it = std::upper_bound(m_sources.begin(), m_sources.end(), source,
+                             [](const Source &a, const Source &b) {
+                               return a.priority < b.priority;
+                             });
+  m_sources.insert(it, source);
+
+  qDebug() << "Registered tick source" << name << "every" << source.periodMs
+           << "ms";
+
+  if (m_timer->isActive()) {
+    scheduleNext();
+  }
+}
+
+void TickScheduler::setSourcePeriod(const QString &name, int periodMs) {
+  for (Source &source : m_sources) {
+    if (source.name != name || source.periodMs == periodMs) {
+      continue;
+    }
+
+    source.periodMs = qMax(1, periodMs);
+
+    // Re-align to the new period, but never delay an already due source
+    if (m_clock.isValid()) {
+      qint64 now = m_clock.elapsed();
+      qint64 aligned = (now / source.periodMs + 1) * source.periodMs;
+      source.nextDueMs = qMin(source.nextDueMs, aligned);
+    }
+
+    if (m_timer->isActive()) {
+      scheduleNext();
+    }
+    return;
+  }
+}
+
+void TickScheduler::unregisterSource(const QString &name) {
+  auto it = std::find_if(
+      m_sources.begin(), m_sources.end(),
+      [&name](const Source &source) { return source.name == name; });
+  if (it == m_sources.end()) {
+    return;
+  }
+
+  m_sources.erase(it);
+  qDebug() << "Unregistered tick source" << name;
+
+  if (m_timer->isActive()) {
+    scheduleNext();
+  }
+}
+
+void TickScheduler::start() {
+  m_clock.start();
+  m_wakeups = 0;
+
+  for (Source &source : m_sources) {
+    source.nextDueMs = 0;
+  }
+
+  onTimeout();
+}
+
+void TickScheduler::stop() { m_timer->stop(); }
+
+double TickScheduler::wakeupsPerSecond() const {
+  if (!m_clock.isValid() || m_clock.elapsed() < 1000) {
+    return 0.0;
+  }
+
+  return m_wakeups * 1000.0 / m_clock.elapsed();
+}
+
+void TickScheduler::onTimeout() {
+  qint64 now = m_clock.elapsed();
+  m_wakeups++;
+
+  for (Source &source : m_sources) {
+    // Non-critical sources run early if they are due within their slack
+    if (source.nextDueMs - slackMs(source) > now) {
+      continue;
+    }
+
+    source.callback();
+
+    source.nextDueMs += source.periodMs;
+    if (source.nextDueMs <= now) {
+      // We fell behind (e.g. a slow read), skip to the next aligned slot
+      source.nextDueMs = (now / source.periodMs + 1) * source.periodMs;
+    }
+  }
+
+  emit tickFinished();
+  scheduleNext();
+}
+
+qint64 TickScheduler::slackMs(const Source &source) {
+  switch (source.priority) {
+  case Priority::Critical:
+    return 0;
+  case Priority::Normal:
+    return source.periodMs / 4;
+  case Priority::Background:
+    return source.periodMs / 2;
+  }
+
+  return 0;
+}
+
+void TickScheduler::scheduleNext() {
+  if (m_sources.isEmpty()) {
+    m_timer->stop();
+    return;
+  }
+
+  // Wake at the earliest deadline, a non-critical source only forces a
+  // wakeup once its slack is used up
+  qint64 wakeAt = std::numeric_limits<qint64>::max();
+  bool critical = false;
+  for (const Source &source : m_sources) {
+    qint64 latest = source.nextDueMs + slackMs(source);
+    if (latest < wakeAt) {
+      wakeAt = latest;
+      critical = source.priority == Priority::Critical;
+    }
+  }
+
+  qint64 interval = qMax<qint64>(0, wakeAt - m_clock.elapsed());
+
+  m_timer->stop();
+  m_timer->setTimerType(critical ? Qt::PreciseTimer : Qt::CoarseTimer);
+  m_timer->start(static_cast<int>(interval));
+}
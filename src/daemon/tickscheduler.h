@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <functional>
+
+// Drives all periodic sampling of the daemon from a single timer.
+// Every source is aligned to a common epoch, so sources with compatible
+// periods share one wakeup. Non-critical sources may be shifted by a slack to
+// join the wakeup of another source instead of waking the process on their
+// own, and wakeups that only serve them use a coarse timer.
+class TickScheduler : public QObject {
+  Q_OBJECT
+
+public:
+  enum class Priority {
+    Critical,  // Runs on time, e.g. GPU power sampling for protection
+    Normal,    // May be shifted by up to a quarter of its period
+    Background // May be shifted by up to half of its period
+  };
+
+  explicit TickScheduler(QObject *parent = nullptr);
+
+  void registerSource(const QString &name, int periodMs, Priority priority,
+                      std::function<void()> callback);
+  void setSourcePeriod(const QString &name, int periodMs);
+
+  // Must not be called from a source callback
+  void unregisterSource(const QString &name);
+
+  void start();
+  void stop();
+
+  quint64 wakeups() const { return m_wakeups; }
+  double wakeupsPerSecond() const;
+
+signals:
+  void tickFinished();
+
+private slots:
+  void onTimeout();
+
+private:
+  struct Source {
+    QString name;
+    int periodMs = 1000;
+    Priority priority = Priority::Normal;
+    std::function<void()> callback;
+    qint64 nextDueMs = 0;
+  };
+
+  static qint64 slackMs(const Source &source);
+  void scheduleNext();
+
+  QList<Source> m_sources; // Sorted by priority
+  QTimer *m_timer;
+  QElapsedTimer m_clock;
+  quint64 m_wakeups = 0;
+};
@@ -0,0 +1,80 @@
+#include "energycounter.h"
+#include <QFile>
+#include <time.h>
+
+namespace {
+// Shorter intervals are dominated by the counter update granularity
+constexpr qint64 kMinimumIntervalNs = 1000000;
+
+constexpr quint64 kCounter32Range = Q_UINT64_C(1) << 32;
+
+// A decrease is only a wraparound if the energy it implies could have been
+// drawn in the interval, a reset would otherwise read as kilowatts
+constexpr double kMaxPlausiblePower = 2000.0; // In watts
+
+qint64 monotonicNs() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return qint64(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+} // namespace
+
+EnergyCounter::EnergyCounter(const QString &energyPath, int counterBits)
+    : m_energyPath(energyPath), m_wraps32(counterBits <= 32) {}
+
+bool EnergyCounter::sample(double *watts) {
+  QFile file(m_energyPath);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+
+  bool ok;
+  quint64 microJoules = file.readAll().trimmed().toULongLong(&ok);
+  qint64 timestampNs = monotonicNs();
+  if (!ok) {
+    return false;
+  }
+
+  bool valid = m_lastTimestampNs >= 0 &&
+               powerBetween(m_lastMicroJoules, m_lastTimestampNs, microJoules,
+                            timestampNs, m_wraps32, watts);
+
+  // Keep the old baseline for intervals that were too short
+  if (valid || m_lastTimestampNs < 0 ||
+      timestampNs - m_lastTimestampNs >= kMinimumIntervalNs) {
+    m_lastMicroJoules = microJoules;
+    m_lastTimestampNs = timestampNs;
+  }
+
+  return valid;
+}
+
+bool EnergyCounter::powerBetween(quint64 previousMicroJoules,
+                                 qint64 previousNs, quint64 microJoules,
+                                 qint64 timestampNs, bool wraps32,
+                                 double *watts) {
+  qint64 intervalNs = timestampNs - previousNs;
+  if (intervalNs < kMinimumIntervalNs) {
+    return false;
+  }
+
+  quint64 deltaMicroJoules;
+  if (microJoules >= previousMicroJoules) {
+    deltaMicroJoules = microJoules - previousMicroJoules;
+  } else {
+    // Counters the driver does not extend to 64 bit wrap at 2^32, anything
+    // else is a driver reload or GPU reset and starts over
+    if (!wraps32 || previousMicroJoules >= kCounter32Range) {
+      return false;
+    }
+
+    deltaMicroJoules = kCounter32Range - previousMicroJoules + microJoules;
+    if (deltaMicroJoules * 1000.0 / intervalNs > kMaxPlausiblePower) {
+      return false;
+    }
+  }
+
+  // µJ per ns is kW
+  *watts = deltaMicroJoules * 1000.0 / intervalNs;
+  return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+// Derives power from a hwmon energyN_input counter (microjoules). Every read
+// is timestamped with the monotonic clock right after the counter was read,
+// so scheduling jitter does not skew the result.
+class EnergyCounter {
+public:
+  EnergyCounter() = default;
+
+  // counterBits is the width of the counter before the driver exposes it.
+  // i915 and xe accumulate their hardware counters into 64 bit, only
+  // narrower ones wrap around.
+  explicit EnergyCounter(const QString &energyPath, int counterBits = 64);
+
+  bool isValid() const { return !m_energyPath.isEmpty(); }
+  QString energyPath() const { return m_energyPath; }
+
+  // Reads the counter and returns the average power since the previous
+  // read. The first read and reads after a counter reset only set the
+  // baseline and return false.
+  bool sample(double *watts);
+
+  // Power between two counter readings, handles a 32 bit wraparound and
+  // rejects resets and too short intervals. A decrease of a 32 bit counter
+  // only counts as a wraparound if the wrapped delta is plausible for the
+  // interval.
+  static bool powerBetween(quint64 previousMicroJoules, qint64 previousNs,
+                           quint64 microJoules, qint64 timestampNs,
+                           bool wraps32, double *watts);
+
+private:
+  QString m_energyPath;
+  bool m_wraps32 = false;
+  quint64 m_lastMicroJoules = 0;
+  qint64 m_lastTimestampNs = -1;
+};
@@ -0,0 +1,405 @@
+#include "fancontroller.h"
+#include <QDebug>
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+// hwmon pwm values are 0-255, pwmN_enable 1 means manual control
+constexpr int kPwmMax = 255;
+constexpr int kPwmEnableManual = 1;
+
+// Never stop a fan completely and only ramp down slowly to avoid oscillation
+constexpr int kMinimumDuty = 20;
+constexpr int kRampDownStep = 5;
+
+// Taking control fails while another tool or the BIOS holds the headers
+constexpr qint64 kMinRetryDelayMs = 5000;
+constexpr qint64 kMaxRetryDelayMs = 300000;
+
+// Pre-rendered writes for the fatal signal handler, which must not allocate
+struct CrashRestoreEntry {
+  char path[256];
+  char value[16];
+  size_t valueLength;
+};
+
+constexpr int kMaxCrashRestoreEntries = 64;
+CrashRestoreEntry g_crashRestoreEntries[kMaxCrashRestoreEntries];
+volatile sig_atomic_t g_crashRestoreCount = 0;
+bool g_crashHandlerInstalled = false;
+
+const int kFatalSignals[] = {SIGSEGV, SIGABRT, SIGBUS, SIGFPE, SIGILL};
+
+void addCrashRestoreEntry(int &count, const QString &path, int value) {
+  if (count >= kMaxCrashRestoreEntries) {
+    return;
+  }
+
+  QByteArray pathBytes = path.toLocal8Bit();
+  QByteArray valueBytes = QByteArray::number(value);
+  CrashRestoreEntry &entry = g_crashRestoreEntries[count];
+  if (pathBytes.size() >= int(sizeof(entry.path)) ||
+      valueBytes.size() >= int(sizeof(entry.value))) {
+    return;
+  }
+
+  std::memcpy(entry.path, pathBytes.constData(), pathBytes.size() + 1);
+  std::memcpy(entry.value, valueBytes.constData(), valueBytes.size() + 1);
+  entry.valueLength = valueBytes.size();
+  count++;
+}
+} // namespace
+
+FanController::FanController(QObject *parent) : QObject(parent) {
+  m_clock.start();
+
+  bool ok;
+  m_temperatureCurve = parseCurve(defaultTemperatureCurve(), &ok);
+  m_gpuPowerCurve = parseCurve(defaultGpuPowerCurve(), &ok);
+}
+
+FanController::~FanController() { restoreControl(); }
+
+void FanController::setHwmonPath(const QString &hwmonPath) {
+  if (m_hwmonPath == hwmonPath)
+    return;
+
+  // Hand the old device back before switching over
+  restoreControl();
+  m_hwmonPath = hwmonPath;
+  discoverChannels();
+
+  if (m_enabled) {
+    m_retryDelayMs = kMinRetryDelayMs;
+    tryTakeControl();
+  }
+}
+
+void FanController::setEnabled(bool enabled) {
+  if (m_enabled == enabled)
+    return;
+
+  m_enabled = enabled;
+  emit enabledChanged();
+
+  if (enabled) {
+    m_retryDelayMs = kMinRetryDelayMs;
+    tryTakeControl();
+    if (!m_inControl && !m_hwmonPath.isEmpty()) {
+      qWarning() << "Fan control enabled, but no controllable pwm channels"
+                 << "found at" << m_hwmonPath;
+    }
+  } else {
+    restoreControl();
+  }
+}
+
+bool FanController::setTemperatureCurve(const QString &curve) {
+  bool ok;
+  QList<FanCurvePoint> points = parseCurve(curve, &ok);
+  if (!ok) {
+    qWarning() << "Invalid fan temperature curve:" << curve;
+    return false;
+  }
+
+  m_temperatureCurve = points;
+  emit curvesChanged();
+  return true;
+}
+
+bool FanController::setGpuPowerCurve(const QString &curve) {
+  bool ok;
+  QList<FanCurvePoint> points = parseCurve(curve, &ok);
+  if (!ok) {
+    qWarning() << "Invalid fan GPU power curve:" << curve;
+    return false;
+  }
+
+  m_gpuPowerCurve = points;
+  emit curvesChanged();
+  return true;
+}
+
+void FanController::update(double temperature, double gpuPower) {
+  if (!m_enabled)
+    return;
+
+  if (!m_inControl) {
+    if (m_hwmonPath.isEmpty() || m_clock.elapsed() < m_nextRetryMs)
+      return;
+
+    tryTakeControl();
+    if (!m_inControl)
+      return;
+  }
+
+  int target = std::max(interpolate(m_temperatureCurve, temperature),
+                        interpolate(m_gpuPowerCurve, gpuPower));
+  target = std::clamp(target, kMinimumDuty, 100);
+
+  // Spin up immediately, but slow down gradually
+  if (target < m_duty) {
+    target = std::max(target, m_duty - kRampDownStep);
+  }
+
+  if (target == m_duty)
+    return;
+
+  writeDuty(target);
+  m_duty = target;
+  emit dutyChanged();
+}
+
+QList<FanCurvePoint> FanController::parseCurve(const QString &curve,
+                                               bool *ok) {
+  QList<FanCurvePoint> points;
+  *ok = true;
+
+  const QStringList pairs = curve.split(',', Qt::SkipEmptyParts);
+  for (const QString &pair : pairs) {
+    QStringList parts = pair.split(':');
+    if (parts.size() != 2) {
+      *ok = false;
+      return {};
+    }
+
+    bool inputOk, dutyOk;
+    FanCurvePoint point;
+    point.input = parts[0].trimmed().toDouble(&inputOk);
+    point.duty = parts[1].trimmed().toInt(&dutyOk);
+    if (!inputOk || !dutyOk || point.duty < 0 || point.duty > 100) {
+      *ok = false;
+      return {};
+    }
+
+    points.append(point);
+  }
+
+  // An empty curve would leave the fans at the minimum duty
+  if (points.isEmpty()) {
+    *ok = false;
+    return {};
+  }
+
+  std::sort(points.begin(), points.end(),
+            [](const FanCurvePoint &a, const FanCurvePoint &b) {
+              return a.input < b.input;
+            });
+
+  return points;
+}
+
+QString FanController::curveToString(const QList<FanCurvePoint> &curve) {
+  QStringList pairs;
+  for (const FanCurvePoint &point : curve) {
+    pairs.append(QString("%1:%2").arg(point.input).arg(point.duty));
+  }
+  return pairs.join(',');
+}
+
+QString FanController::defaultTemperatureCurve() {
+  return "40:30,60:50,75:80,85:100";
+}
+
+QString FanController::defaultGpuPowerCurve() {
+  return "100:40,200:70,300:100";
+}
+
+int FanController::interpolate(const QList<FanCurvePoint> &curve,
+                               double input) {
+  if (curve.isEmpty()) {
+    return 0;
+  }
+
+  if (input <= curve.first().input) {
+    return curve.first().duty;
+  }
+
+  for (int i = 1; i < curve.size(); ++i) {
+    const FanCurvePoint &low = curve[i - 1];
+    const FanCurvePoint &high = curve[i];
+    if (input <= high.input) {
+      double ratio = (input - low.input) / (high.input - low.input);
+      return qRound(low.duty + ratio * (high.duty - low.duty));
+    }
+  }
+
+  return curve.last().duty;
+}
+
+void FanController::discoverChannels() {
+  m_channels.clear();
+
+  if (m_hwmonPath.isEmpty()) {
+    return;
+  }
+
+  for (int i = 1; i <= 15; ++i) {
+    PwmChannel channel;
+    channel.pwmPath = QString("%1/pwm%2").arg(m_hwmonPath).arg(i);
+    channel.enablePath = channel.pwmPath + "_enable";
+
+    if (QFile::exists(channel.pwmPath) && QFile::exists(channel.enablePath)) {
+      m_channels.append(channel);
+    }
+  }
+
+  qDebug() << "Found" << m_channels.size() << "pwm fan channels at"
+           << m_hwmonPath;
+}
+
+void FanController::tryTakeControl() {
+  m_inControl = takeControl();
+  if (m_inControl) {
+    m_retryDelayMs = kMinRetryDelayMs;
+    return;
+  }
+
+  m_nextRetryMs = m_clock.elapsed() + m_retryDelayMs;
+  m_retryDelayMs = std::min(m_retryDelayMs * 2, kMaxRetryDelayMs);
+}
+
+bool FanController::takeControl() {
+  if (m_inControl) {
+    return true;
+  }
+
+  if (m_channels.isEmpty()) {
+    discoverChannels();
+  }
+
+  QList<PwmChannel> controlled;
+  for (PwmChannel channel : m_channels) {
+    channel.originalEnable = readSysfsInt(channel.enablePath);
+    channel.originalPwm = readSysfsInt(channel.pwmPath);
+    if (channel.originalEnable < 0 || channel.originalPwm < 0) {
+      continue;
+    }
+
+    // Keep the current speed after switching over to manual mode, some
+    // drivers reject pwm writes in automatic mode
+    if (!writeSysfsInt(channel.enablePath, kPwmEnableManual) ||
+        !writeSysfsInt(channel.pwmPath, channel.originalPwm)) {
+      writeSysfsInt(channel.enablePath, channel.originalEnable);
+      continue;
+    }
+
+    controlled.append(channel);
+  }
+
+  // Channels that failed stay known, the next attempt tries them again
+  m_controlled = controlled;
+  if (m_controlled.isEmpty()) {
+    return false;
+  }
+
+  armCrashRestore(m_controlled);
+
+  m_duty = (m_controlled.first().originalPwm * 100) / kPwmMax;
+  emit dutyChanged();
+
+  qInfo() << "Took manual control of" << m_controlled.size() << "of"
+          << m_channels.size() << "fan channels at" << m_hwmonPath;
+  return true;
+}
+
+void FanController::restoreControl() {
+  if (!m_inControl) {
+    return;
+  }
+
+  for (const PwmChannel &channel : std::as_const(m_controlled)) {
+    writeSysfsInt(channel.pwmPath, channel.originalPwm);
+    writeSysfsInt(channel.enablePath, channel.originalEnable);
+  }
+
+  disarmCrashRestore();
+  m_controlled.clear();
+  m_inControl = false;
+
+  qInfo() << "Restored original fan control modes at" << m_hwmonPath;
+}
+
+void FanController::writeDuty(int duty) {
+  int pwmValue = (duty * kPwmMax) / 100;
+  for (const PwmChannel &channel : std::as_const(m_controlled)) {
+    writeSysfsInt(channel.pwmPath, pwmValue);
+  }
+}
+
+int FanController::readSysfsInt(const QString &path) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    return -1;
+  }
+
+  bool ok;
+  int value = QTextStream(&file).readAll().trimmed().toInt(&ok);
+  return ok ? value : -1;
+}
+
+bool FanController::writeSysfsInt(const QString &path, int value) {
+  QFile file(path);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    qWarning() << "Failed to open" << path << ":" << file.errorString();
+    return false;
+  }
+
+  QTextStream out(&file);
+  out << value;
+  file.close();
+
+  if (file.error() != QFile::NoError) {
+    qWarning() << "Error writing to" << path << ":" << file.errorString();
+    return false;
+  }
+
+  return true;
+}
+
+void FanController::armCrashRestore(const QList<PwmChannel> &channels) {
+  // Block the handler while the table is rewritten
+  g_crashRestoreCount = 0;
+
+  int count = 0;
+  for (const PwmChannel &channel : channels) {
+    addCrashRestoreEntry(count, channel.pwmPath, channel.originalPwm);
+    addCrashRestoreEntry(count, channel.enablePath, channel.originalEnable);
+  }
+  g_crashRestoreCount = count;
+
+  if (!g_crashHandlerInstalled) {
+    struct sigaction action = {};
+    action.sa_handler = &FanController::crashSignalHandler;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    for (int signal : kFatalSignals) {
+      sigaction(signal, &action, nullptr);
+    }
+    g_crashHandlerInstalled = true;
+  }
+}
+
+void FanController::disarmCrashRestore() { g_crashRestoreCount = 0; }
+
+void FanController::crashSignalHandler(int signal) {
+  // Only async-signal-safe calls from here on
+  for (int i = 0; i < g_crashRestoreCount; ++i) {
+    const CrashRestoreEntry &entry = g_crashRestoreEntries[i];
+    int fd = ::open(entry.path, O_WRONLY);
+    if (fd >= 0) {
+      ssize_t written = ::write(fd, entry.value, entry.valueLength);
+      (void)written;
+      ::close(fd);
+    }
+  }
+
+  // SA_RESETHAND restored the default action, re-raise to still crash
+  ::raise(signal);
+}
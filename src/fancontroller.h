@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+struct FanCurvePoint {
+  double input = 0.0; // Temperature in Celsius or GPU power in watts
+  int duty = 0;       // Fan duty in percent (0-100)
+};
+
+// Drives the motherboard pwm fan headers along configurable curves so the
+// case and CPU fans can cool the VRMs before CPU throughput is given up.
+// While enabled, all controlled pwmN_enable files are switched to manual mode
+// and the original modes are restored on disable, exit and on fatal signals.
+// If no channel can be taken over, it is retried with a growing delay.
+class FanController : public QObject {
+  Q_OBJECT
+  Q_PROPERTY(bool enabled READ enabled WRITE setEnabled NOTIFY enabledChanged)
+  Q_PROPERTY(int duty READ duty NOTIFY dutyChanged)
+  Q_PROPERTY(QString temperatureCurve READ temperatureCurve WRITE
+                 setTemperatureCurve NOTIFY curvesChanged)
+  Q_PROPERTY(QString gpuPowerCurve READ gpuPowerCurve WRITE setGpuPowerCurve
+                 NOTIFY curvesChanged)
+
+public:
+  explicit FanController(QObject *parent = nullptr);
+  ~FanController() override;
+
+  bool enabled() const { return m_enabled; }
+  int duty() const { return m_duty; }
+  QString temperatureCurve() const { return curveToString(m_temperatureCurve); }
+  QString gpuPowerCurve() const { return curveToString(m_gpuPowerCurve); }
+  int channelCount() const { return m_channels.size(); }
+
+  void setHwmonPath(const QString &hwmonPath);
+  void setEnabled(bool enabled);
+  bool setTemperatureCurve(const QString &curve);
+  bool setGpuPowerCurve(const QString &curve);
+
+  // Feed the latest readings, the duty is taken from whichever curve demands
+  // more cooling
+  void update(double temperature, double gpuPower);
+
+  // Curves are serialized as "input:duty" pairs, e.g. "40:30,60:50,80:100".
+  // A curve needs at least one pair.
+  static QList<FanCurvePoint> parseCurve(const QString &curve, bool *ok);
+  static QString curveToString(const QList<FanCurvePoint> &curve);
+  static int interpolate(const QList<FanCurvePoint> &curve, double input);
+
+  // The built-in curves every controller starts with
+  static QString defaultTemperatureCurve();
+  static QString defaultGpuPowerCurve();
+
+signals:
+  void enabledChanged();
+  void dutyChanged();
+  void curvesChanged();
+
+private:
+  struct PwmChannel {
+    QString pwmPath;
+    QString enablePath;
+    int originalEnable = -1;
+    int originalPwm = -1;
+  };
+
+  void discoverChannels();
+  void tryTakeControl();
+  bool takeControl();
+  void restoreControl();
+  void writeDuty(int duty);
+
+  static int readSysfsInt(const QString &path);
+  static bool writeSysfsInt(const QString &path, int value);
+  static void armCrashRestore(const QList<PwmChannel> &channels);
+  static void disarmCrashRestore();
+  static void crashSignalHandler(int signal);
+
+  QString m_hwmonPath;
+  QList<PwmChannel> m_channels;   // All pwm channels of the hwmon
+  QList<PwmChannel> m_controlled; // Those taken over, with original values
+  QList<FanCurvePoint> m_temperatureCurve;
+  QList<FanCurvePoint> m_gpuPowerCurve;
+  bool m_enabled = false;
+  bool m_inControl = false;
+  int m_duty = 0;
+
+  QElapsedTimer m_clock;
+  qint64 m_nextRetryMs = 0;
+  qint64 m_retryDelayMs = 0;
+};
@@ -0,0 +1,137 @@
+#include "gpumetrics.h"
+#include <QDebug>
+#include <QFile>
+#include <QtEndian>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+// All tables start with: u16 structure_size, u8 format_revision,
+// u8 content_revision
+constexpr int kHeaderSize = 4;
+
+// Offsets into the v1 tables (kgd_pp_interface.h). v1.0 has padding after
+// the header, v1.1 moved the 64 bit counters behind the 16 bit fields.
+struct LayoutV1 {
+  int edgeTemperature;
+  int hotspotTemperature;
+  int memoryTemperature;
+  int gfxActivity;
+  int socketPower;
+};
+
+constexpr LayoutV1 kLayoutV1_0 = {16, 18, 20, 28, 34};
+constexpr LayoutV1 kLayoutV1_1 = {4, 6, 8, 16, 22};
+
+// The clock, throttle and fan fields line up again in all v1 revisions
+constexpr int kAverageGfxClock = 40;
+constexpr int kAverageMemoryClock = 44;
+constexpr int kCurrentGfxClock = 54;
+constexpr int kCurrentMemoryClock = 58;
+constexpr int kThrottleStatus = 68;
+constexpr int kFanSpeed = 72;
+constexpr int kMinimumSizeV1 = kFanSpeed + 2;
+
+// Fields the SMU does not fill in
+constexpr quint16 kNotAvailable = 0xffff;
+
+int readU16(const char *data, int offset) {
+  quint16 value = qFromLittleEndian<quint16>(data + offset);
+  return value == kNotAvailable ? -1 : value;
+}
+
+int readClock(const char *data, int currentOffset, int averageOffset) {
+  int clock = readU16(data, currentOffset);
+  return clock > 0 ? clock : readU16(data, averageOffset);
+}
+} // namespace
+
+GpuMetricsReader::~GpuMetricsReader() { close(); }
+
+void GpuMetricsReader::setDevicePath(const QString &devicePath) {
+  QString path = devicePath.isEmpty() ? QString() : devicePath + "/gpu_metrics";
+  if (path == m_path)
+    return;
+
+  close();
+  m_path = path;
+  m_unsupported = !m_path.isEmpty() && !QFile::exists(m_path);
+}
+
+bool GpuMetricsReader::read(GpuMetrics *metrics) {
+  if (!isSupported()) {
+    return false;
+  }
+
+  if (m_fd < 0) {
+    QByteArray path = m_path.toLocal8Bit();
+    m_fd = ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0) {
+      return false;
+    }
+  }
+
+  // The newest tables are a few hundred bytes
+  char buffer[1024];
+  ssize_t length = ::pread(m_fd, buffer, sizeof(buffer), 0);
+  if (length <= 0) {
+    return false;
+  }
+
+  if (!parse(buffer, static_cast<int>(length), metrics)) {
+    qInfo() << "Unsupported gpu_metrics table revision"
+            << metrics->formatRevision << "." << metrics->contentRevision
+            << "at" << m_path << ", using hwmon instead";
+    m_unsupported = true;
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+bool GpuMetricsReader::parse(const char *data, int size, GpuMetrics *metrics) {
+  *metrics = GpuMetrics();
+  if (size < kHeaderSize) {
+    return false;
+  }
+
+  int structureSize = qFromLittleEndian<quint16>(data);
+  metrics->formatRevision = static_cast<quint8>(data[2]);
+  metrics->contentRevision = static_cast<quint8>(data[3]);
+
+  // v2 tables are APU layouts with different units, v1.4 and later are the
+  // data center layouts
+  if (metrics->formatRevision != 1 || metrics->contentRevision > 3) {
+    return false;
+  }
+
+  if (size < kMinimumSizeV1 || structureSize < kMinimumSizeV1) {
+    return false;
+  }
+
+  const LayoutV1 &layout =
+      metrics->contentRevision == 0 ? kLayoutV1_0 : kLayoutV1_1;
+
+  // v1 temperatures are in Celsius, the power in watts
+  metrics->edgeTemperature = readU16(data, layout.edgeTemperature);
+  metrics->hotspotTemperature = readU16(data, layout.hotspotTemperature);
+  metrics->memoryTemperature = readU16(data, layout.memoryTemperature);
+  metrics->gfxActivity = readU16(data, layout.gfxActivity);
+  metrics->socketPower = readU16(data, layout.socketPower);
+
+  metrics->gfxClock = readClock(data, kCurrentGfxClock, kAverageGfxClock);
+  metrics->memoryClock =
+      readClock(data, kCurrentMemoryClock, kAverageMemoryClock);
+  metrics->throttleStatus = qFromLittleEndian<quint32>(data + kThrottleStatus);
+  metrics->fanSpeed = readU16(data, kFanSpeed);
+
+  return true;
+}
+
+void GpuMetricsReader::close() {
+  if (m_fd >= 0) {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+// One sample of the amdgpu gpu_metrics table. Fields the table does not
+// provide are -1.
+struct GpuMetrics {
+  int formatRevision = 0;
+  int contentRevision = 0;
+  double socketPower = -1;        // In watts, averaged by the SMU
+  double edgeTemperature = -1;    // In Celsius
+  double hotspotTemperature = -1; // Junction temperature
+  double memoryTemperature = -1;
+  int gfxClock = -1;    // In MHz
+  int memoryClock = -1; // In MHz
+  int gfxActivity = -1; // In percent
+  int fanSpeed = -1;    // In RPM
+  quint32 throttleStatus = 0;
+};
+
+// Reads /sys/class/drm/cardN/device/gpu_metrics, a binary table with power,
+// temperatures, clocks and activity of an AMD GPU. A sample is one pread of
+// a file kept open. Unsupported table revisions are detected on the first
+// read, callers then fall back to the hwmon files.
+class GpuMetricsReader {
+public:
+  GpuMetricsReader() = default;
+  ~GpuMetricsReader();
+
+  GpuMetricsReader(const GpuMetricsReader &) = delete;
+  GpuMetricsReader &operator=(const GpuMetricsReader &) = delete;
+
+  // PCI device directory of the GPU, an empty path closes the reader
+  void setDevicePath(const QString &devicePath);
+  bool isSupported() const { return !m_path.isEmpty() && !m_unsupported; }
+
+  bool read(GpuMetrics *metrics);
+
+  // Parses a gpu_metrics v1.0 to v1.3 table
+  static bool parse(const char *data, int size, GpuMetrics *metrics);
+
+private:
+  void close();
+
+  QString m_path;
+  int m_fd = -1;
+  bool m_unsupported = false;
+};
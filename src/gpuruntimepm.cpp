@@ -0,0 +1,86 @@
+#include "gpuruntimepm.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+namespace {
+QString readTrimmed(const QString &path) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    return QString();
+  }
+
+  return QTextStream(&file).readAll().trimmed();
+}
+} // namespace
+
+GpuRuntimePm::GpuRuntimePm(const QString &pciDevicePath) {
+  // Resolve symlinks like /sys/class/hwmon/hwmonN/device
+  QFileInfo info(pciDevicePath);
+  if (info.exists()) {
+    m_pciDevicePath = info.canonicalFilePath();
+  }
+}
+
+GpuRuntimePm GpuRuntimePm::findByVendor(const QString &vendorId) {
+  const QList<GpuRuntimePm> gpus = findAllByVendor(vendorId);
+  return gpus.isEmpty() ? GpuRuntimePm() : gpus.first();
+}
+
+QList<GpuRuntimePm> GpuRuntimePm::findAllByVendor(const QString &vendorId) {
+  QList<GpuRuntimePm> gpus;
+  QDir pciDir("/sys/bus/pci/devices");
+  const QStringList devices =
+      pciDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+
+  for (const QString &device : devices) {
+    QString devicePath = pciDir.absoluteFilePath(device);
+
+    // PCI class 0x03xxxx is a display controller
+    if (!readTrimmed(devicePath + "/class").startsWith("0x03")) {
+      continue;
+    }
+
+    if (readTrimmed(devicePath + "/vendor").compare(
+            vendorId, Qt::CaseInsensitive) == 0) {
+      gpus.append(GpuRuntimePm(devicePath));
+    }
+  }
+
+  return gpus;
+}
+
+QString GpuRuntimePm::pciAddress() const {
+  return QFileInfo(m_pciDevicePath).fileName();
+}
+
+GpuRuntimePm::State GpuRuntimePm::state() const {
+  if (m_pciDevicePath.isEmpty()) {
+    return State::Unknown;
+  }
+
+  QString status = readTrimmed(m_pciDevicePath + "/power/runtime_status");
+  if (status == "suspended" || status == "suspending") {
+    return State::Suspended;
+  }
+  if (status == "active" || status == "resuming") {
+    return State::Active;
+  }
+
+  // "unsupported", "error" or no runtime PM at all
+  return State::Unknown;
+}
+
+QString GpuRuntimePm::stateName(State state) {
+  switch (state) {
+  case State::Active:
+    return "active";
+  case State::Suspended:
+    return "suspended";
+  case State::Unknown:
+    break;
+  }
+
+  return "unknown";
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QList>
+#include <QString>
+
+// Reads the PCI runtime power management state of a GPU.
+// Reading power/runtime_status never resumes the device, so it can be checked
+// before every sample to avoid waking up a runtime-suspended dGPU with
+// nvidia-smi or hwmon reads.
+class GpuRuntimePm {
+public:
+  enum class State { Unknown, Active, Suspended };
+
+  GpuRuntimePm() = default;
+  explicit GpuRuntimePm(const QString &pciDevicePath);
+
+  // Finds the display controllers of a PCI vendor, e.g. "0x10de"
+  static GpuRuntimePm findByVendor(const QString &vendorId);
+  static QList<GpuRuntimePm> findAllByVendor(const QString &vendorId);
+
+  bool isValid() const { return !m_pciDevicePath.isEmpty(); }
+  QString pciDevicePath() const { return m_pciDevicePath; }
+  QString pciAddress() const;
+
+  State state() const;
+  bool isSuspended() const { return state() == State::Suspended; }
+
+  static QString stateName(State state);
+
+private:
+  QString m_pciDevicePath; // e.g. /sys/bus/pci/devices/0000:01:00.0
+};
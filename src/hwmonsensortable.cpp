@@ -0,0 +1,255 @@
+#include "hwmonsensortable.h"
+#include <QDBusMetaType>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QMap>
+#include <QPair>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QThreadPool>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+struct ChannelType {
+  const char *prefix;
+  const char *unit;
+  double scale; // sysfs reports milli- or micro-units
+};
+
+const ChannelType kChannelTypes[] = {
+    {"temp", "C", 0.001}, {"fan", "RPM", 1.0},     {"in", "V", 0.001},
+    {"curr", "A", 0.001}, {"power", "W", 0.000001}};
+
+QString readSysfsLine(const QString &path) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    return QString();
+  }
+  return QTextStream(&file).readLine().trimmed();
+}
+} // namespace
+
+QDBusArgument &operator<<(QDBusArgument &argument,
+                          const SensorChannelInfo &info) {
+  argument.beginStructure();
+  argument << info.hwmon << info.device << info.channel << info.label
+           << info.unit;
+  argument.endStructure();
+  return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument,
+                                SensorChannelInfo &info) {
+  argument.beginStructure();
+  argument >> info.hwmon >> info.device >> info.channel >> info.label >>
+      info.unit;
+  argument.endStructure();
+  return argument;
+}
+
+QDBusArgument &operator<<(QDBusArgument &argument,
+                          const SensorReading &reading) {
+  argument.beginStructure();
+  argument << reading.value << reading.valid;
+  argument.endStructure();
+  return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument,
+                                SensorReading &reading) {
+  argument.beginStructure();
+  argument >> reading.value >> reading.valid;
+  argument.endStructure();
+  return argument;
+}
+
+HwmonSensorTable::HwmonSensorTable(QObject *parent) : QObject(parent) {}
+
+HwmonSensorTable::~HwmonSensorTable() { closeFiles(); }
+
+void HwmonSensorTable::registerDBusTypes() {
+  qDBusRegisterMetaType<SensorChannelInfo>();
+  qDBusRegisterMetaType<QList<SensorChannelInfo>>();
+  qDBusRegisterMetaType<SensorReading>();
+  qDBusRegisterMetaType<QList<SensorReading>>();
+}
+
+void HwmonSensorTable::startRebuild() {
+  // Coalesce bursts of hwmon events into one more scan
+  if (m_rebuildPending) {
+    m_rebuildQueued = true;
+    return;
+  }
+  m_rebuildPending = true;
+
+  QThreadPool::globalInstance()->start([this]() {
+    Enumeration enumeration = enumerate();
+    QMetaObject::invokeMethod(
+        this, [this, enumeration]() { applyEnumeration(enumeration); },
+        Qt::QueuedConnection);
+  });
+}
+
+void HwmonSensorTable::handleUevent(const Uevent &event) {
+  if (event.subsystem != "hwmon") {
+    return;
+  }
+
+  if (event.action == "add" || event.action == "remove") {
+    startRebuild();
+  }
+}
+
+HwmonSensorTable::Enumeration HwmonSensorTable::enumerate() {
+  static const QRegularExpression inputPattern(
+      "^(temp|fan|in|curr|power)(\\d+)_(input|average)$");
+
+  Enumeration result;
+  QDir hwmonDir("/sys/class/hwmon");
+  QStringList hwmons = hwmonDir.entryList(QStringList() << "hwmon*",
+                                          QDir::Dirs | QDir::NoDotAndDotDot);
+
+  // hwmon10 sorts after hwmon9
+  std::sort(hwmons.begin(), hwmons.end(),
+            [](const QString &a, const QString &b) {
+              return a.mid(5).toInt() < b.mid(5).toInt();
+            });
+
+  for (const QString &hwmon : hwmons) {
+    QDir dir(hwmonDir.absoluteFilePath(hwmon));
+    QString device = readSysfsLine(dir.filePath("name"));
+
+    // amdgpu, i915, xe and nouveau hwmons sit on the GPU's PCI device
+    int gpu = -1;
+    if (readSysfsLine(dir.filePath("device/class")).startsWith("0x03")) {
+      gpu = result.gpus.size();
+      result.gpus.append(GpuRuntimePm(dir.filePath("device")));
+    }
+
+    // Ordered by type, then channel number. power*_input is preferred over
+    // power*_average where a driver has both.
+    QMap<QPair<int, int>, QString> inputs;
+    const QStringList files = dir.entryList(QDir::Files);
+    for (const QString &file : files) {
+      QRegularExpressionMatch match = inputPattern.match(file);
+      if (!match.hasMatch()) {
+        continue;
+      }
+
+      int typeIndex = 0;
+      while (match.captured(1) != kChannelTypes[typeIndex].prefix) {
+        typeIndex++;
+      }
+
+      QPair<int, int> key(typeIndex, match.captured(2).toInt());
+      if (!inputs.contains(key) || match.captured(3) == "input") {
+        inputs.insert(key, file);
+      }
+    }
+
+    for (auto it = inputs.cbegin(); it != inputs.cend(); ++it) {
+      const ChannelType &type = kChannelTypes[it.key().first];
+
+      SensorChannelInfo info;
+      info.hwmon = hwmon;
+      info.device = device;
+      info.channel = QString("%1%2").arg(type.prefix).arg(it.key().second);
+      info.label = readSysfsLine(dir.filePath(info.channel + "_label"));
+      if (info.label.isEmpty()) {
+        info.label = info.channel;
+      }
+      info.unit = type.unit;
+
+      ChannelSource source;
+      source.inputPath = dir.filePath(it.value());
+      source.scale = type.scale;
+      source.gpu = gpu;
+
+      result.channels.append(info);
+      result.sources.append(source);
+    }
+  }
+
+  return result;
+}
+
+void HwmonSensorTable::applyEnumeration(const Enumeration &enumeration) {
+  closeFiles();
+
+  m_channels = enumeration.channels;
+  m_readings = QList<SensorReading>(m_channels.size());
+  for (const ChannelSource &source : enumeration.sources) {
+    QByteArray path = source.inputPath.toLocal8Bit();
+    m_fds.append(::open(path.constData(), O_RDONLY | O_CLOEXEC));
+    m_scales.append(source.scale);
+    m_channelGpus.append(source.gpu);
+  }
+  m_gpus = enumeration.gpus;
+  m_generation++;
+
+  qInfo() << "Sensor table has" << m_channels.size() << "hwmon channels";
+
+  sample();
+  emit rebuilt();
+
+  m_rebuildPending = false;
+  if (m_rebuildQueued) {
+    m_rebuildQueued = false;
+    startRebuild();
+  }
+}
+
+void HwmonSensorTable::sample() {
+  char buffer[32];
+
+  // One runtime_status read per GPU, it never resumes the device
+  QList<bool> suspended;
+  for (const GpuRuntimePm &gpu : std::as_const(m_gpus)) {
+    suspended.append(gpu.isSuspended());
+  }
+
+  for (int i = 0; i < m_fds.size(); ++i) {
+    SensorReading &reading = m_readings[i];
+    reading.valid = false;
+
+    if (m_fds[i] < 0) {
+      continue;
+    }
+    if (m_channelGpus[i] >= 0 && suspended[m_channelGpus[i]]) {
+      continue;
+    }
+
+    // Disconnected channels fail with ENODATA or EIO
+    ssize_t length = ::pread(m_fds[i], buffer, sizeof(buffer) - 1, 0);
+    if (length <= 0) {
+      continue;
+    }
+    buffer[length] = '\0';
+
+    char *end;
+    errno = 0;
+    long long raw = std::strtoll(buffer, &end, 10);
+    if (end == buffer || errno != 0) {
+      continue;
+    }
+
+    reading.value = raw * m_scales[i];
+    reading.valid = true;
+  }
+}
+
+void HwmonSensorTable::closeFiles() {
+  for (int fd : std::as_const(m_fds)) {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+  m_fds.clear();
+  m_scales.clear();
+  m_channelGpus.clear();
+}
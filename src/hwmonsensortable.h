@@ -0,0 +1,100 @@
+#pragma once
+
+#include "gpuruntimepm.h"
+#include "ueventmonitor.h"
+#include <QDBusArgument>
+#include <QList>
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+
+// Static description of one hwmon channel, published once per table
+// generation
+struct SensorChannelInfo {
+  QString hwmon;   // e.g. "hwmon3"
+  QString device;  // hwmon name, e.g. "k10temp" or "amdgpu"
+  QString channel; // e.g. "temp3", "fan1" or "power1"
+  QString label;   // channel label if the driver has one, else the channel
+  QString unit;    // "C", "RPM", "V", "A" or "W"
+};
+
+// One sample, index-aligned with the channel table
+struct SensorReading {
+  double value = 0.0; // In the channel's unit
+  bool valid = false;
+};
+
+Q_DECLARE_METATYPE(SensorChannelInfo)
+Q_DECLARE_METATYPE(SensorReading)
+
+QDBusArgument &operator<<(QDBusArgument &argument,
+                          const SensorChannelInfo &info);
+const QDBusArgument &operator>>(const QDBusArgument &argument,
+                                SensorChannelInfo &info);
+QDBusArgument &operator<<(QDBusArgument &argument,
+                          const SensorReading &reading);
+const QDBusArgument &operator>>(const QDBusArgument &argument,
+                                SensorReading &reading);
+
+// Enumerates every temp*, fan*, in*, curr* and power* channel of all hwmon
+// devices into a flat, index-addressed table. Channel files stay open, so a
+// sample is one pread per channel. Channels of a runtime-suspended GPU are
+// not read, the read would wake it up.
+class HwmonSensorTable : public QObject {
+  Q_OBJECT
+
+public:
+  explicit HwmonSensorTable(QObject *parent = nullptr);
+  ~HwmonSensorTable() override;
+
+  static void registerDBusTypes();
+
+  // Enumerates the channels on a worker thread, rebuilt() is emitted once
+  // the new table is in place
+  void startRebuild();
+
+  // Rebuilds the table when a hwmon device comes or goes
+  void handleUevent(const Uevent &event);
+
+  // Incremented on every rebuild, indexes are only valid within one
+  // generation
+  uint generation() const { return m_generation; }
+  QList<SensorChannelInfo> channels() const { return m_channels; }
+  QList<SensorReading> readings() const { return m_readings; }
+  int size() const { return m_channels.size(); }
+
+public slots:
+  // Called by the daemon's tick scheduler
+  void sample();
+
+signals:
+  void rebuilt();
+
+private:
+  struct ChannelSource {
+    QString inputPath;
+    double scale = 1.0; // Raw sysfs value to the channel's unit
+    int gpu = -1;       // Index into the GPUs if the hwmon belongs to one
+  };
+
+  struct Enumeration {
+    QList<SensorChannelInfo> channels;
+    QList<ChannelSource> sources;
+    QList<GpuRuntimePm> gpus;
+  };
+
+  // Runs on a worker thread and must not touch any members
+  static Enumeration enumerate();
+  void applyEnumeration(const Enumeration &enumeration);
+  void closeFiles();
+
+  QList<SensorChannelInfo> m_channels;
+  QList<SensorReading> m_readings;
+  QList<int> m_fds; // Input file per channel, -1 if it could not be opened
+  QList<double> m_scales;
+  QList<int> m_channelGpus;
+  QList<GpuRuntimePm> m_gpus;
+  uint m_generation = 0;
+  bool m_rebuildPending = false;
+  bool m_rebuildQueued = false;
+};
@@ -266,8 +266,8 @@ Kirigami.ApplicationWindow {
                                             return "Idle";
                                         }
 
-                                        // AMD GPUs report RPM, NVIDIA reports percentage
-                                        if (vendor === "AMD") {
+                                        // AMD and Intel GPUs report RPM, NVIDIA reports percentage
+                                        if (vendor === "AMD" || vendor === "Intel") {
                                             return speed + " RPM";
                                         } else if (vendor === "NVIDIA") {
                                             return speed + " %";
@@ -1,18 +1,332 @@
 #include "powermonitor.h"
+#include <QDBusMetaType>
 #include <QDebug>
 #include <QDir>
 #include <QFile>
 #include <QProcess>
+#include <QTextStream>
+#include <QThreadPool>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+// Physical limits of a single GPU, samples outside are read errors
+constexpr double kMaxGpuPower = 2000.0;      // In watts
+constexpr double kMinGpuTemperature = 1.0;   // In Celsius
+constexpr double kMaxGpuTemperature = 150.0; // In Celsius
+
+// Changes up to these are never treated as outliers
+constexpr double kPowerDeviation = 15.0;      // In watts
+constexpr double kTemperatureDeviation = 5.0; // In Celsius
+
+QString readTrimmed(const QString &path) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    return QString();
+  }
+
+  return QTextStream(&file).readAll().trimmed();
+}
+
+// Reads an integer hwmon attribute, -1 if it is missing or unreadable
+qint64 readHwmonValue(const QString &path) {
+  bool ok;
+  qint64 value = readTrimmed(path).toLongLong(&ok);
+  return ok ? value : -1;
+}
+
+// nvidia-smi reports "00000000:01:00.0", sysfs "0000:01:00.0"
+QString normalizePciAddress(const QString &busId) {
+  QString address = busId.trimmed().toLower();
+  if (address.count(':') == 2) {
+    address = address.section(':', 0, 0).right(4) + ":" +
+              address.section(':', 1);
+  }
+  return address;
+}
+} // namespace
+
+QDBusArgument &operator<<(QDBusArgument &argument,
+                          const GpuDeviceStatus &status) {
+  argument.beginStructure();
+  argument << status.id << status.vendor << status.name << status.state
+           << status.power << status.instantPower << status.temperature
+           << status.fanSpeed << status.powerThreshold
+           << status.thresholdExceeded;
+  argument.endStructure();
+  return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument,
+                                GpuDeviceStatus &status) {
+  argument.beginStructure();
+  argument >> status.id >> status.vendor >> status.name >> status.state >>
+      status.power >> status.instantPower >> status.temperature >>
+      status.fanSpeed >> status.powerThreshold >> status.thresholdExceeded;
+  argument.endStructure();
+  return argument;
+}
 
 PowerMonitor::PowerMonitor(QObject *parent) : QObject(parent) {
-  m_updateTimer = new QTimer(this);
-  connect(m_updateTimer, &QTimer::timeout, this, &PowerMonitor::updateGpuPower);
+  m_clock.start();
+}
+
+PowerMonitor::~PowerMonitor() { qDeleteAll(m_devices); }
+
+PowerMonitor::GpuDevice::~GpuDevice() {
+  if (powerInputFd >= 0) {
+    ::close(powerInputFd);
+  }
+}
+
+void PowerMonitor::registerDBusTypes() {
+  qDBusRegisterMetaType<GpuDeviceStatus>();
+  qDBusRegisterMetaType<QList<GpuDeviceStatus>>();
+}
+
+void PowerMonitor::startProbe() {
+  // The running probe may already have listed the directories the event was
+  // about
+  if (m_pendingProbes > 0) {
+    m_reprobe = true;
+    return;
+  }
+  m_pendingProbes = 2;
+
+  QThreadPool::globalInstance()->start([this]() {
+    QList<DeviceProbe> probes = probeNvidiaDevices();
+    QMetaObject::invokeMethod(
+        this,
+        [this, probes]() {
+          applyProbe(true, probes);
+          probeFinished();
+        },
+        Qt::QueuedConnection);
+  });
+
+  QThreadPool::globalInstance()->start([this]() {
+    QList<DeviceProbe> probes = probeHwmonDevices();
+    QMetaObject::invokeMethod(
+        this,
+        [this, probes]() {
+          applyProbe(false, probes);
+          probeFinished();
+        },
+        Qt::QueuedConnection);
+  });
+}
+
+QList<PowerMonitor::DeviceProbe> PowerMonitor::probeNvidiaDevices() {
+  QList<DeviceProbe> probes;
+
+  const QList<GpuRuntimePm> gpus = GpuRuntimePm::findAllByVendor("0x10de");
+  if (gpus.isEmpty()) {
+    return probes;
+  }
+
+  // Runtime-suspended dGPUs are used as they are, nvidia-smi would wake
+  // them up. Active ones need a working nvidia-smi to be sampled at all.
+  bool anyActive = std::any_of(
+      gpus.begin(), gpus.end(),
+      [](const GpuRuntimePm &gpu) { return !gpu.isSuspended(); });
+
+  QMap<QString, QString> names;
+  if (anyActive) {
+    QProcess nvidiaSmi;
+    nvidiaSmi.start("nvidia-smi", QStringList()
+                                      << "--query-gpu=pci.bus_id,name"
+                                      << "--format=csv,noheader");
+    if (!nvidiaSmi.waitForFinished(3000) || nvidiaSmi.exitCode() != 0) {
+      return probes;
+    }
+
+    const QStringList lines =
+        QString::fromUtf8(nvidiaSmi.readAllStandardOutput())
+            .split('\n', Qt::SkipEmptyParts);
+    for (const QString &line : lines) {
+      names.insert(normalizePciAddress(line.section(',', 0, 0)),
+                   line.section(',', 1).trimmed());
+    }
+  }
+
+  for (const GpuRuntimePm &gpu : gpus) {
+    DeviceProbe probe;
+    probe.status.id = gpu.pciAddress();
+    probe.status.vendor = "NVIDIA";
+    probe.status.name = names.value(probe.status.id, "NVIDIA GPU");
+    probe.source = PowerSource::Nvidia;
+    probe.runtimePm = gpu;
+    probes.append(probe);
+  }
+
+  return probes;
+}
+
+QList<PowerMonitor::DeviceProbe> PowerMonitor::probeHwmonDevices() {
+  QList<DeviceProbe> probes;
+
+  // amdgpu reports power directly, the Intel dGPU drivers only an energy
+  // counter
+  QDir hwmonDir("/sys/class/hwmon");
+  const QStringList hwmonDevices =
+      hwmonDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+  for (const QString &hwmon : hwmonDevices) {
+    QString hwmonPath = hwmonDir.absoluteFilePath(hwmon);
+    QString name = readTrimmed(hwmonPath + "/name");
+
+    DeviceProbe probe;
+    if (name == "amdgpu" &&
+        (QFile::exists(hwmonPath + "/power1_average") ||
+         QFile::exists(hwmonPath + "/power1_input") ||
+         QFile::exists(hwmonPath + "/device/gpu_metrics"))) {
+      probe.source = PowerSource::AmdHwmon;
+      probe.status.vendor = "AMD";
+      probe.status.name = readTrimmed(hwmonPath + "/device/product_name");
+      if (probe.status.name.isEmpty()) {
+        probe.status.name = "AMD GPU";
+      }
+    } else if ((name == "i915" || name == "xe") &&
+               QFile::exists(hwmonPath + "/energy1_input")) {
+      probe.source = PowerSource::IntelHwmon;
+      probe.status.vendor = "Intel";
+      QString deviceId = readTrimmed(hwmonPath + "/device/device");
+      probe.status.name = deviceId.isEmpty()
+                              ? QString("Intel GPU")
+                              : QString("Intel GPU [%1]").arg(deviceId);
+    } else {
+      continue;
+    }
+
+    probe.hwmonPath = hwmonPath;
+    probe.runtimePm = GpuRuntimePm(hwmonPath + "/device");
+    probe.status.id = probe.runtimePm.pciAddress();
+    probes.append(probe);
+  }
+
+  return probes;
+}
+
+void PowerMonitor::applyProbe(bool nvidia, const QList<DeviceProbe> &probes) {
+  // A probe replaces the devices of its kind, devices that are still there
+  // are kept with their open files and energy baselines
+  QList<GpuDevice *> devices;
+  QList<GpuDevice *> removed;
+  for (GpuDevice *device : std::as_const(m_devices)) {
+    bool sameKind = (device->source == PowerSource::Nvidia) == nvidia;
+    bool found = std::any_of(probes.begin(), probes.end(),
+                             [device](const DeviceProbe &probe) {
+                               return probe.status.id == device->status.id &&
+                                      probe.hwmonPath == device->hwmonPath;
+                             });
+    if (sameKind && !found) {
+      qWarning() << "GPU" << device->status.id << device->status.name
+                 << "was removed";
+      removed.append(device);
+    } else {
+      devices.append(device);
+    }
+  }
 
-  // Update every 1 second
-  m_updateTimer->start(1000);
+  bool changed = !removed.isEmpty();
+  qDeleteAll(removed);
 
-  // Initial update
-  updateGpuPower();
+  for (const DeviceProbe &probe : probes) {
+    bool known = std::any_of(devices.begin(), devices.end(),
+                             [&probe](const GpuDevice *device) {
+                               return device->status.id == probe.status.id &&
+                                      device->hwmonPath == probe.hwmonPath;
+                             });
+    if (known) {
+      continue;
+    }
+
+    auto *device = new GpuDevice;
+    device->status = probe.status;
+    device->status.state = "unknown";
+    device->source = probe.source;
+    device->hwmonPath = probe.hwmonPath;
+    device->runtimePm = probe.runtimePm;
+    device->powerFilter = SensorFilter(0.0, kMaxGpuPower, kPowerDeviation);
+    device->instantPowerFilter = SensorFilter(0.0, kMaxGpuPower, 0.0, 1);
+    device->temperatureFilter =
+        SensorFilter(kMinGpuTemperature, kMaxGpuTemperature,
+                     kTemperatureDeviation);
+    if (probe.source == PowerSource::AmdHwmon) {
+      device->metrics.setDevicePath(probe.hwmonPath + "/device");
+
+      // Only newer GPUs (RDNA3 and later) report power1_input
+      QByteArray path = (probe.hwmonPath + "/power1_input").toLocal8Bit();
+      device->powerInputFd = ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+    } else if (probe.source == PowerSource::IntelHwmon) {
+      QString energyPath = probe.hwmonPath + "/energy1_input";
+      // i915 and xe extend the hardware counter to 64 bit
+      device->energyCounter = EnergyCounter(energyPath, 64);
+      device->peakEnergyCounter = EnergyCounter(energyPath, 64);
+
+      // Set the baseline, so the first tick already has a power value
+      double watts;
+      device->energyCounter.sample(&watts);
+      device->peakEnergyCounter.sample(&watts);
+    }
+
+    qInfo() << "GPU found:" << probe.status.id << probe.status.name << "via"
+            << (probe.source == PowerSource::Nvidia ? "nvidia-smi"
+                                                    : probe.hwmonPath);
+    devices.append(device);
+    changed = true;
+  }
+
+  // Drop the removed devices even if nothing else changed
+  m_devices = devices;
+  if (!changed) {
+    return;
+  }
+
+  std::sort(m_devices.begin(), m_devices.end(),
+            [](const GpuDevice *a, const GpuDevice *b) {
+              return a->status.id < b->status.id;
+            });
+  emit devicesChanged();
+}
+
+void PowerMonitor::handleUevent(const Uevent &event) {
+  if (event.subsystem != "hwmon" && event.subsystem != "drm") {
+    return;
+  }
+
+  // Late driver loads, GPU resets and hot-unplug all change the device
+  // list, probing again keeps the devices that are still there
+  if (event.action == "add" || event.action == "remove") {
+    startProbe();
+  }
+}
+
+void PowerMonitor::probeFinished() {
+  if (--m_pendingProbes > 0) {
+    return;
+  }
+
+  emit probeCompleted();
+
+  if (m_reprobe) {
+    m_reprobe = false;
+    startProbe();
+    return;
+  }
+
+  if (m_devices.isEmpty()) {
+    qWarning()
+        << "Could not find GPU power reading (tried NVIDIA, AMD and Intel)";
+  }
+}
+
+QList<GpuDeviceStatus> PowerMonitor::devices() const {
+  QList<GpuDeviceStatus> devices;
+  for (const GpuDevice *device : m_devices) {
+    devices.append(device->status);
+  }
+  return devices;
 }
 
 void PowerMonitor::setGpuPowerThreshold(double threshold) {
@@ -22,83 +336,506 @@ void PowerMonitor::setGpuPowerThreshold(double threshold) {
   m_gpuPowerThreshold = threshold;
   emit gpuPowerThresholdChanged();
 
-  // Re-check threshold
-  bool wasExceeded = m_thresholdExceeded;
-  m_thresholdExceeded = m_gpuPower > m_gpuPowerThreshold;
-  if (wasExceeded != m_thresholdExceeded) {
-    emit thresholdExceededChanged();
+  // Re-check thresholds
+  evaluateThresholds();
+}
+
+QString PowerMonitor::gpuPowerMode() const {
+  return m_powerMode == PowerMode::Instant ? "instant" : "average";
+}
+
+bool PowerMonitor::setGpuPowerMode(const QString &mode) {
+  PowerMode powerMode;
+  if (mode == "average") {
+    powerMode = PowerMode::Average;
+  } else if (mode == "instant") {
+    powerMode = PowerMode::Instant;
+  } else {
+    qWarning() << "Unknown GPU power mode" << mode;
+    return false;
   }
+
+  if (m_powerMode == powerMode)
+    return true;
+
+  m_powerMode = powerMode;
+  qInfo() << "GPU power mode:" << gpuPowerMode();
+  emit gpuPowerModeChanged();
+
+  evaluateThresholds();
+  return true;
+}
+
+void PowerMonitor::setGpuDeviceThreshold(const QString &id,
+                                         double threshold) {
+  if (threshold > 0) {
+    if (qFuzzyCompare(m_deviceThresholds.value(id), threshold))
+      return;
+    m_deviceThresholds.insert(id, threshold);
+  } else if (m_deviceThresholds.remove(id) == 0) {
+    return;
+  }
+
+  emit gpuDeviceThresholdsChanged();
+  evaluateThresholds();
 }
 
 void PowerMonitor::updateGpuPower() {
-  double newPower = readGpuPowerFromSysfs();
+  // Never wake up a runtime-suspended dGPU, nvidia-smi and hwmon reads would
+  // resume it on every sample. A sleeping GPU draws (almost) nothing, report
+  // 0 W until it is active again.
+  bool nvidiaActive = false;
+  for (GpuDevice *device : std::as_const(m_devices)) {
+    if (device->runtimePm.isSuspended()) {
+      device->status.state = "suspended";
+      device->status.power = 0.0;
+      continue;
+    }
+
+    switch (device->source) {
+    case PowerSource::Nvidia:
+      // Awake again, sampleNvidiaDevices() skips what is still "suspended"
+      device->status.state = "unknown";
+      nvidiaActive = true;
+      break;
+    case PowerSource::AmdHwmon:
+      sampleAmdDevice(device);
+      break;
+    case PowerSource::IntelHwmon:
+      sampleIntelDevice(device);
+      break;
+    case PowerSource::None:
+      break;
+    }
+  }
+
+  // One nvidia-smi call covers every NVIDIA GPU
+  if (nvidiaActive) {
+    sampleNvidiaDevices();
+  }
+
+  double newPower = 0.0;
+  double newInstantPower = 0.0;
+  int active = 0;
+  int suspended = 0;
+  qint64 now = m_clock.elapsed();
+  for (GpuDevice *device : std::as_const(m_devices)) {
+    GpuDeviceStatus &status = device->status;
+
+    // A spike caught by the fast samples since the last tick wins
+    if (status.state == "active") {
+      status.instantPower =
+          std::max({status.instantPower, device->peakPower, 0.0});
+    } else {
+      status.instantPower = 0.0;
+    }
+    device->peakPower = -1;
+
+    filterDevice(device, now);
+
+    newPower += status.power;
+    newInstantPower += status.instantPower;
+    active += status.state == "active";
+    suspended += status.state == "suspended";
+  }
+
+  if (active > 0) {
+    setGpuState("active");
+  } else if (suspended > 0 && suspended == m_devices.size()) {
+    setGpuState("suspended");
+  } else {
+    setGpuState("unknown");
+  }
 
   if (!qFuzzyCompare(m_gpuPower, newPower)) {
     m_gpuPower = newPower;
     emit gpuPowerChanged();
   }
 
-  // Check threshold
-  bool wasExceeded = m_thresholdExceeded;
-  m_thresholdExceeded = m_gpuPower > m_gpuPowerThreshold;
-  if (wasExceeded != m_thresholdExceeded) {
+  if (!qFuzzyCompare(m_gpuInstantPower, newInstantPower)) {
+    m_gpuInstantPower = newInstantPower;
+    emit gpuInstantPowerChanged();
+  }
+
+  // Check thresholds
+  bool wasRawExceeded = m_rawThresholdExceeded;
+  evaluateThresholds();
+
+  // A raw crossing the filtered values did not follow only was a glitch if
+  // the next sample is back below the thresholds
+  if (m_possibleFalseTrip && !m_rawThresholdExceeded) {
+    m_falseTripsAvoided++;
+    qInfo() << "Filtered GPU power sample avoided a protection trip";
+  }
+  m_possibleFalseTrip =
+      m_rawThresholdExceeded && !wasRawExceeded && !m_thresholdExceeded;
+}
+
+void PowerMonitor::filterDevice(GpuDevice *device, qint64 nowMs) {
+  GpuDeviceStatus &status = device->status;
+
+  // A sleeping GPU really draws nothing, start over once it wakes up
+  if (status.state == "suspended") {
+    device->powerFilter.reset();
+    device->instantPowerFilter.reset();
+    device->temperatureFilter.reset();
+    device->rawPower = 0.0;
+    device->rawInstantPower = 0.0;
+    return;
+  }
+
+  if (status.state == "active") {
+    device->rawPower = status.power;
+    device->rawInstantPower = status.instantPower;
+
+    // A real load step has a MAD of 0 and looks like an outlier on its
+    // first sample. Rises that would trip the protection are read again
+    // right away instead of waiting a tick, a glitch doesn't repeat.
+    SensorFilter::Verdict verdict =
+        device->powerFilter.add(status.power, nowMs);
+    if (verdict == SensorFilter::Verdict::Outlier &&
+        status.power > device->powerFilter.value() &&
+        crossesThreshold(device, status.power)) {
+      double confirmed = confirmPower(device);
+      if (confirmed >= 0 && crossesThreshold(device, confirmed)) {
+        device->powerFilter.overrule(status.power, nowMs);
+        verdict = SensorFilter::Verdict::Accepted;
+      } else {
+        qDebug() << "GPU" << status.id << "power of" << status.power
+                 << "W not confirmed, read" << confirmed << "W";
+      }
+    }
+    m_filterCounters.count(verdict);
+    m_filterCounters.count(
+        device->instantPowerFilter.add(status.instantPower, nowMs));
+
+    // Intel GPUs may have no temperature channel at all
+    if (status.temperature > 0) {
+      m_filterCounters.count(
+          device->temperatureFilter.add(status.temperature, nowMs));
+    }
+  } else {
+    device->rawPower = 0.0;
+    device->rawInstantPower = 0.0;
+    m_filterCounters.missing++;
+  }
+
+  // Failed and rejected reads hold the last accepted values until they are
+  // stale, so a single bad nvidia-smi call neither trips nor releases the
+  // protection
+  if (device->powerFilter.becameStale(nowMs)) {
+    m_filterCounters.stale++;
+    qWarning() << "GPU" << status.id << "power reading is stale";
+  }
+
+  if (device->powerFilter.isStale(nowMs)) {
+    status.state = "unknown";
+    status.power = 0.0;
+    status.instantPower = 0.0;
+    return;
+  }
+
+  status.state = "active";
+  status.power = device->powerFilter.value();
+  status.instantPower = device->instantPowerFilter.hasValue()
+                            ? device->instantPowerFilter.value()
+                            : status.power;
+  status.temperature = device->temperatureFilter.value();
+}
+
+double PowerMonitor::confirmPower(GpuDevice *device) {
+  switch (device->source) {
+  case PowerSource::Nvidia: {
+    QMap<QString, QStringList> samples;
+    if (!runNvidiaSmi("pci.bus_id,power.draw", {device->status.id},
+                      &samples)) {
+      return -1;
+    }
+    const QStringList fields = samples.value(device->status.id);
+    bool valid = false;
+    double power = fields.value(1).trimmed().toDouble(&valid);
+    return valid ? power : -1;
+  }
+  case PowerSource::AmdHwmon: {
+    double power = readPowerInput(device->powerInputFd);
+    GpuMetrics metrics;
+    if (power < 0 && device->metrics.read(&metrics)) {
+      power = metrics.socketPower;
+    }
+    return power;
+  }
+  case PowerSource::IntelHwmon: {
+    // Since the last fast sample, the tick's own counter keeps its baseline
+    double watts = -1;
+    if (!device->peakEnergyCounter.sample(&watts)) {
+      return -1;
+    }
+    return watts;
+  }
+  case PowerSource::None:
+    break;
+  }
+  return -1;
+}
+
+bool PowerMonitor::crossesThreshold(const GpuDevice *device,
+                                    double power) const {
+  double threshold = m_deviceThresholds.value(device->status.id, 0.0);
+  if (threshold > 0 && power > threshold) {
+    return true;
+  }
+
+  // The other GPUs as of the previous tick
+  double others = m_gpuPower - device->powerFilter.value();
+  return others + power > m_gpuPowerThreshold;
+}
+
+void PowerMonitor::evaluateThresholds() {
+  bool instant = m_powerMode == PowerMode::Instant;
+  bool exceeded =
+      (instant ? m_gpuInstantPower : m_gpuPower) > m_gpuPowerThreshold;
+
+  // The same decision on the unfiltered samples, to count the trips the
+  // filters avoided
+  double rawPower = 0.0;
+  bool rawDeviceExceeded = false;
+  for (GpuDevice *device : std::as_const(m_devices)) {
+    GpuDeviceStatus &status = device->status;
+    double power = instant ? status.instantPower : status.power;
+    double raw = instant ? device->rawInstantPower : device->rawPower;
+    status.powerThreshold = m_deviceThresholds.value(status.id, 0.0);
+    status.thresholdExceeded =
+        status.powerThreshold > 0 && power > status.powerThreshold;
+    exceeded = exceeded || status.thresholdExceeded;
+
+    rawPower += raw;
+    if (status.powerThreshold > 0 && raw > status.powerThreshold) {
+      rawDeviceExceeded = true;
+    }
+  }
+
+  m_rawThresholdExceeded =
+      rawPower > m_gpuPowerThreshold || rawDeviceExceeded;
+
+  if (exceeded != m_thresholdExceeded) {
+    m_thresholdExceeded = exceeded;
     emit thresholdExceededChanged();
   }
 }
 
-double PowerMonitor::readGpuPowerFromSysfs() {
-  // Try NVIDIA first using nvidia-smi
+void PowerMonitor::setGpuState(const QString &state) {
+  if (m_gpuState == state)
+    return;
+
+  m_gpuState = state;
+  qDebug() << "GPU power state:" << m_gpuState;
+  emit gpuStateChanged();
+}
+
+bool PowerMonitor::hasPeakPowerSources() const {
+  return std::any_of(
+      m_devices.begin(), m_devices.end(), [](const GpuDevice *device) {
+        return (device->source == PowerSource::AmdHwmon &&
+                device->powerInputFd >= 0) ||
+               (device->source == PowerSource::IntelHwmon &&
+                device->peakEnergyCounter.isValid());
+      });
+}
+
+void PowerMonitor::samplePeakPower() {
+  for (GpuDevice *device : std::as_const(m_devices)) {
+    // Only what was active on the last tick, runtime_status is not
+    // re-read at this rate
+    if (device->status.state != "active") {
+      continue;
+    }
+
+    double watts = -1;
+    if (device->source == PowerSource::AmdHwmon) {
+      watts = readPowerInput(device->powerInputFd);
+    } else if (device->source == PowerSource::IntelHwmon &&
+               !device->peakEnergyCounter.sample(&watts)) {
+      watts = -1;
+    }
+
+    device->peakPower = std::max(device->peakPower, watts);
+  }
+}
+
+void PowerMonitor::sampleNvidiaDevices() {
+  // Only the active GPUs, a query without --id wakes up the suspended ones
+  QStringList ids;
+  for (const GpuDevice *device : std::as_const(m_devices)) {
+    if (device->source == PowerSource::Nvidia &&
+        device->status.state != "suspended") {
+      ids.append(device->status.id);
+    }
+  }
+
+  // A bare --id= would be rejected, or worse, wake up every GPU
+  if (ids.isEmpty()) {
+    return;
+  }
+
+  QMap<QString, QStringList> samples;
+
+  // power.draw is averaged over a second, power.draw.instant is only known
+  // to newer drivers, which reject the whole query otherwise
+  bool ok = m_nvidiaInstantSupported &&
+            runNvidiaSmi("pci.bus_id,power.draw,temperature.gpu,fan.speed,"
+                         "power.draw.instant",
+                         ids, &samples);
+  if (!ok) {
+    ok = runNvidiaSmi("pci.bus_id,power.draw,temperature.gpu,fan.speed", ids,
+                      &samples);
+    if (ok && m_nvidiaInstantSupported) {
+      qInfo() << "nvidia-smi does not support power.draw.instant, using "
+                 "power.draw only";
+      m_nvidiaInstantSupported = false;
+    }
+  }
+  if (!ok) {
+    qWarning() << "Could not read GPU power from nvidia-smi";
+  }
+
+  for (GpuDevice *device : std::as_const(m_devices)) {
+    if (device->source != PowerSource::Nvidia ||
+        device->status.state == "suspended") {
+      continue;
+    }
+
+    const QStringList fields = samples.value(device->status.id);
+    bool valid = false;
+    double power =
+        fields.isEmpty() ? 0.0 : fields[1].trimmed().toDouble(&valid);
+
+    device->status.state = valid ? "active" : "unknown";
+    device->status.power = valid ? power : 0.0;
+    device->status.instantPower = device->status.power;
+    if (valid) {
+      // Passively cooled cards report "[N/A]" as fan speed, read as 0
+      device->status.temperature = fields[2].trimmed().toDouble();
+      device->status.fanSpeed = fields[3].trimmed().toInt();
+
+      bool instantValid = false;
+      double instantPower =
+          fields.value(4).trimmed().toDouble(&instantValid);
+      if (instantValid) {
+        device->status.instantPower = instantPower;
+      }
+    }
+  }
+}
+
+bool PowerMonitor::runNvidiaSmi(const QString &query, const QStringList &ids,
+                                QMap<QString, QStringList> *samples) {
   QProcess nvidiaSmi;
   nvidiaSmi.start("nvidia-smi", QStringList()
-                                    << "--query-gpu=power.draw"
+                                    << "--id=" + ids.join(',')
+                                    << "--query-gpu=" + query
                                     << "--format=csv,noheader,nounits");
-  if (nvidiaSmi.waitForStarted(1000)) {
-    if (nvidiaSmi.waitForFinished(2000)) {
-      if (nvidiaSmi.exitCode() == 0) {
-        QString output =
-            QString::fromUtf8(nvidiaSmi.readAllStandardOutput()).trimmed();
-        bool ok;
-        double power = output.toDouble(&ok);
-        if (ok && power > 0) {
-          return power;
-        }
-      }
-    }
+  if (!nvidiaSmi.waitForStarted(1000) || !nvidiaSmi.waitForFinished(2000) ||
+      nvidiaSmi.exitCode() != 0) {
+    return false;
   }
 
-  // Try AMD GPU sysfs
-  QDir hwmonDir("/sys/class/hwmon");
-  if (hwmonDir.exists()) {
-    QStringList hwmonDevices =
-        hwmonDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-    for (const QString &device : hwmonDevices) {
-      QString namePath = QString("/sys/class/hwmon/%1/name").arg(device);
-      QFile nameFile(namePath);
-      if (nameFile.open(QIODevice::ReadOnly)) {
-        QString name = QString::fromUtf8(nameFile.readAll()).trimmed();
-        nameFile.close();
-
-        // Check if this is an AMD GPU (amdgpu)
-        if (name == "amdgpu") {
-          // Try to read power1_average (in microwatts)
-          QString powerPath =
-              QString("/sys/class/hwmon/%1/power1_average").arg(device);
-          QFile powerFile(powerPath);
-          if (powerFile.open(QIODevice::ReadOnly)) {
-            QString powerStr = QString::fromUtf8(powerFile.readAll()).trimmed();
-            bool ok;
-            qint64 powerMicroWatts = powerStr.toLongLong(&ok);
-            if (ok) {
-              // Convert from microwatts to watts
-              double powerWatts = powerMicroWatts / 1000000.0;
-              return powerWatts;
-            }
-          }
-        }
-      }
+  int fieldCount = query.count(',') + 1;
+  const QStringList lines =
+      QString::fromUtf8(nvidiaSmi.readAllStandardOutput())
+          .split('\n', Qt::SkipEmptyParts);
+  for (const QString &line : lines) {
+    QStringList fields = line.split(',');
+    if (fields.size() >= fieldCount) {
+      samples->insert(normalizePciAddress(fields[0]), fields);
     }
   }
 
-  qWarning() << "Could not find GPU power reading (tried NVIDIA and AMD)";
-  return 0.0;
+  return true;
+}
+
+double PowerMonitor::readPowerInput(int fd) {
+  if (fd < 0) {
+    return -1;
+  }
+
+  // power1_input in microwatts
+  char buffer[32];
+  ssize_t length = ::pread(fd, buffer, sizeof(buffer) - 1, 0);
+  if (length <= 0) {
+    return -1;
+  }
+  buffer[length] = '\0';
+
+  bool ok;
+  qint64 microWatts = QByteArray(buffer).trimmed().toLongLong(&ok);
+  return ok ? microWatts / 1000000.0 : -1;
+}
+
+void PowerMonitor::sampleAmdDevice(GpuDevice *device) {
+  GpuDeviceStatus &status = device->status;
+
+  // power1_input is not averaged by the SMU, gpu_metrics v1.0 to v1.3 and
+  // power1_average are
+  double instantPower = readPowerInput(device->powerInputFd);
+
+  // gpu_metrics has power, temperature and fan speed in one read
+  GpuMetrics metrics;
+  if (device->metrics.read(&metrics) && metrics.socketPower >= 0) {
+    status.state = "active";
+    status.power = metrics.socketPower;
+    status.instantPower = instantPower >= 0 ? instantPower : status.power;
+    status.temperature = std::max(metrics.edgeTemperature, 0.0);
+    status.fanSpeed = std::max(metrics.fanSpeed, 0);
+    return;
+  }
+
+  // power1_average in microwatts, temp1_input in millidegrees. GPUs without
+  // power1_average only have the instantaneous value.
+  qint64 powerMicroWatts =
+      readHwmonValue(device->hwmonPath + "/power1_average");
+  if (powerMicroWatts < 0 && instantPower < 0) {
+    qWarning() << "Could not read GPU power from" << device->hwmonPath;
+    status.state = "unknown";
+    status.power = 0.0;
+    status.instantPower = 0.0;
+    return;
+  }
+
+  qint64 temperature = readHwmonValue(device->hwmonPath + "/temp1_input");
+  qint64 fanSpeed = readHwmonValue(device->hwmonPath + "/fan1_input");
+
+  status.state = "active";
+  status.power =
+      powerMicroWatts >= 0 ? powerMicroWatts / 1000000.0 : instantPower;
+  status.instantPower = instantPower >= 0 ? instantPower : status.power;
+  status.temperature = std::max(temperature, qint64(0)) / 1000.0;
+  status.fanSpeed = int(std::max(fanSpeed, qint64(0)));
+}
+
+void PowerMonitor::sampleIntelDevice(GpuDevice *device) {
+  GpuDeviceStatus &status = device->status;
+
+  // energy1_input in microjoules, the power is its rate of change. Over a
+  // whole tick it is the average, samplePeakPower() catches the peaks.
+  double watts = 0.0;
+  if (!device->energyCounter.sample(&watts)) {
+    qWarning() << "Could not read GPU energy from" << device->hwmonPath;
+    status.state = "unknown";
+    status.power = 0.0;
+    status.instantPower = 0.0;
+    return;
+  }
+
+  // xe reports the package in temp2, i915 only has one on newer kernels
+  qint64 temperature = readHwmonValue(device->hwmonPath + "/temp1_input");
+  if (temperature <= 0) {
+    temperature = readHwmonValue(device->hwmonPath + "/temp2_input");
+  }
+  qint64 fanSpeed = readHwmonValue(device->hwmonPath + "/fan1_input");
+
+  status.state = "active";
+  status.power = watts;
+  status.instantPower = watts;
+  status.temperature = std::max(temperature, qint64(0)) / 1000.0;
+  status.fanSpeed = int(std::max(fanSpeed, qint64(0)));
 }
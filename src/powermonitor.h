@@ -1,7 +1,37 @@
 #pragma once
 
+#include "energycounter.h"
+#include "gpumetrics.h"
+#include "gpuruntimepm.h"
+#include "sensorfilter.h"
+#include "ueventmonitor.h"
+#include <QDBusArgument>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMap>
+#include <QMetaType>
 #include <QObject>
-#include <QTimer>
+
+// Telemetry of one GPU, published as an array over DBus
+struct GpuDeviceStatus {
+  QString id;     // PCI address, e.g. "0000:03:00.0"
+  QString vendor; // "NVIDIA", "AMD" or "Intel"
+  QString name;
+  QString state;                  // "active", "suspended" or "unknown"
+  double power = 0.0;             // Smoothed by the driver, in watts
+  double instantPower = 0.0;      // Peak since the previous sample
+  double temperature = 0.0;       // In Celsius
+  int fanSpeed = 0;               // In RPM, in percent for NVIDIA
+  double powerThreshold = 0.0;    // Per-device threshold, 0 if none
+  bool thresholdExceeded = false; // Per-device threshold exceeded
+};
+
+Q_DECLARE_METATYPE(GpuDeviceStatus)
+
+QDBusArgument &operator<<(QDBusArgument &argument,
+                          const GpuDeviceStatus &status);
+const QDBusArgument &operator>>(const QDBusArgument &argument,
+                                GpuDeviceStatus &status);
 
 class PowerMonitor : public QObject {
   Q_OBJECT
@@ -10,29 +40,166 @@ class PowerMonitor : public QObject {
                  setGpuPowerThreshold NOTIFY gpuPowerThresholdChanged)
   Q_PROPERTY(bool thresholdExceeded READ thresholdExceeded NOTIFY
                  thresholdExceededChanged)
+  Q_PROPERTY(QString gpuState READ gpuState NOTIFY gpuStateChanged)
+  Q_PROPERTY(double gpuInstantPower READ gpuInstantPower NOTIFY
+                 gpuInstantPowerChanged)
+  Q_PROPERTY(QString gpuPowerMode READ gpuPowerMode WRITE setGpuPowerMode
+                 NOTIFY gpuPowerModeChanged)
 
 public:
+  enum class PowerSource { None, Nvidia, AmdHwmon, IntelHwmon };
+
+  // Which value the thresholds act on. power1_average and nvidia-smi's
+  // power.draw are averaged over up to a second and hide the short spikes
+  // that trip a PSU's over-current protection.
+  enum class PowerMode {
+    Average, // Driver-smoothed power
+    Instant  // Instantaneous power, peaks sampled at a high rate
+  };
+
   explicit PowerMonitor(QObject *parent = nullptr);
+  ~PowerMonitor() override;
 
+  static void registerDBusTypes();
+
+  // Summed over all GPUs, the summed power threshold applies to it
   double gpuPower() const { return m_gpuPower; }
   double gpuPowerThreshold() const { return m_gpuPowerThreshold; }
+
+  // Summed instantaneous power, the highest fast sample since the previous
+  // tick in instant mode
+  double gpuInstantPower() const { return m_gpuInstantPower; }
+
+  // "average" or "instant"
+  QString gpuPowerMode() const;
+  PowerMode powerMode() const { return m_powerMode; }
+  bool setGpuPowerMode(const QString &mode);
+
+  // Summed power or any per-device threshold exceeded
   bool thresholdExceeded() const { return m_thresholdExceeded; }
 
+  // "active" if any GPU is active, "suspended" if all are suspended
+  QString gpuState() const { return m_gpuState; }
+
   void setGpuPowerThreshold(double threshold);
 
+  // Per-device power thresholds by PCI address, 0 removes a threshold
+  QMap<QString, double> gpuDeviceThresholds() const {
+    return m_deviceThresholds;
+  }
+  void setGpuDeviceThreshold(const QString &id, double threshold);
+
+  // Samples rejected by the per-device filters, and threshold crossings
+  // of the raw samples the filtered values did not follow
+  SensorFilterCounters filterCounters() const { return m_filterCounters; }
+  quint64 falseTripsAvoided() const { return m_falseTripsAvoided; }
+
+  // Every GPU ordered by PCI address, with its last sample
+  QList<GpuDeviceStatus> devices() const;
+  bool hasDevices() const { return !m_devices.isEmpty(); }
+
+  // An AMD GPU with power1_input or an Intel GPU with an energy counter,
+  // samplePeakPower() has nothing to read for the others
+  bool hasPeakPowerSources() const;
+
+  // Finds all GPUs on worker threads, NVIDIA and the AMD and Intel hwmons
+  // are probed concurrently and devicesChanged() is emitted as soon as the
+  // first ones are found. Called during a probe, another one follows it, so
+  // devices that appeared meanwhile are not missed.
+  void startProbe();
+  bool isProbing() const { return m_pendingProbes > 0; }
+
+  // Re-probes when a GPU hwmon or drm device comes or goes
+  void handleUevent(const Uevent &event);
+
+public slots:
+  // Called by the daemon's tick scheduler
+  void updateGpuPower();
+
+  // Reads the cheap instantaneous sources (AMD power1_input, Intel energy
+  // deltas) and keeps their peak until the next updateGpuPower(). Called
+  // at a high rate in instant mode only.
+  void samplePeakPower();
+
 signals:
   void gpuPowerChanged();
   void gpuPowerThresholdChanged();
+  void gpuDeviceThresholdsChanged();
   void thresholdExceededChanged();
-
-private slots:
-  void updateGpuPower();
+  void gpuStateChanged();
+  void gpuInstantPowerChanged();
+  void gpuPowerModeChanged();
+  void devicesChanged();
+  void probeCompleted();
 
 private:
-  double readGpuPowerFromSysfs();
+  // What a probe found, resolved on a worker thread
+  struct DeviceProbe {
+    GpuDeviceStatus status;
+    PowerSource source = PowerSource::None;
+    QString hwmonPath; // AMD and Intel
+    GpuRuntimePm runtimePm;
+  };
+
+  // One sampled GPU, holds the open files of its source
+  struct GpuDevice {
+    ~GpuDevice();
+
+    GpuDeviceStatus status;
+    PowerSource source = PowerSource::None;
+    QString hwmonPath;
+    GpuRuntimePm runtimePm;
+    GpuMetricsReader metrics;    // AMD, preferred over the hwmon files
+    EnergyCounter energyCounter; // Intel, energy1_input deltas per tick
+    int powerInputFd = -1;       // AMD power1_input, instantaneous
+
+    // Fast samples between two ticks, -1 while there are none
+    EnergyCounter peakEnergyCounter; // Intel, short energy1_input deltas
+    double peakPower = -1;
+
+    // Raw samples go through the filters before they reach the status
+    SensorFilter powerFilter;
+    SensorFilter instantPowerFilter; // Range only, peaks are real
+    SensorFilter temperatureFilter;
+    double rawPower = 0.0;
+    double rawInstantPower = 0.0;
+  };
+
+  // Probes run on worker threads and must not touch any members
+  static QList<DeviceProbe> probeNvidiaDevices();
+  static QList<DeviceProbe> probeHwmonDevices();
+  void applyProbe(bool nvidia, const QList<DeviceProbe> &probes);
+  void probeFinished();
+
+  void sampleNvidiaDevices();
+  bool runNvidiaSmi(const QString &query, const QStringList &ids,
+                    QMap<QString, QStringList> *samples);
+  static double readPowerInput(int fd);
+  void sampleAmdDevice(GpuDevice *device);
+  void sampleIntelDevice(GpuDevice *device);
+  void filterDevice(GpuDevice *device, qint64 nowMs);
+  // A second, immediate read of the power, -1 if there is none
+  double confirmPower(GpuDevice *device);
+  bool crossesThreshold(const GpuDevice *device, double power) const;
+  void evaluateThresholds();
+  void setGpuState(const QString &state);
+
+  QList<GpuDevice *> m_devices; // Ordered by PCI address
+  QMap<QString, double> m_deviceThresholds;
+  int m_pendingProbes = 0;
+  bool m_reprobe = false; // Requested while a probe was running
+  QString m_gpuState = "unknown"; // "active", "suspended" or "unknown"
 
-  QTimer *m_updateTimer;
   double m_gpuPower = 0.0;
   double m_gpuPowerThreshold = 100.0;
+  double m_gpuInstantPower = 0.0;
   bool m_thresholdExceeded = false;
+  bool m_rawThresholdExceeded = false;
+  bool m_possibleFalseTrip = false; // Confirmed by the next sample
+  PowerMode m_powerMode = PowerMode::Average;
+  bool m_nvidiaInstantSupported = true; // power.draw.instant, driver 530+
+
+  SensorFilterCounters m_filterCounters;
+  quint64 m_falseTripsAvoided = 0;
+  QElapsedTimer m_clock;
 };
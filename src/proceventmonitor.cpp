@@ -0,0 +1,162 @@
+#include "proceventmonitor.h"
+#include <QDebug>
+#include <QSocketNotifier>
+#include <cerrno>
+#include <cstring>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+// Values of enum proc_cn_event, older headers nest it inside struct
+// proc_event where C++ can't name it the same way
+constexpr unsigned int kEventExec = 0x00000002;
+constexpr unsigned int kEventExit = 0x80000000;
+
+// Parallel builds exec thousands of processes per second
+constexpr int kReceiveBufferSize = 1024 * 1024;
+} // namespace
+
+ProcEventMonitor::ProcEventMonitor(QObject *parent) : QObject(parent) {}
+
+ProcEventMonitor::~ProcEventMonitor() { stop(); }
+
+bool ProcEventMonitor::start() {
+  if (m_socket >= 0) {
+    return true;
+  }
+
+  m_socket = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+                      NETLINK_CONNECTOR);
+  if (m_socket < 0) {
+    qWarning() << "Failed to open proc connector socket:"
+               << std::strerror(errno);
+    return false;
+  }
+
+  int bufferSize = kReceiveBufferSize;
+  if (::setsockopt(m_socket, SOL_SOCKET, SO_RCVBUFFORCE, &bufferSize,
+                   sizeof(bufferSize)) < 0) {
+    ::setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, &bufferSize,
+                 sizeof(bufferSize));
+  }
+
+  sockaddr_nl address = {};
+  address.nl_family = AF_NETLINK;
+  address.nl_groups = CN_IDX_PROC;
+  if (::bind(m_socket, reinterpret_cast<sockaddr *>(&address),
+             sizeof(address)) < 0 ||
+      !sendMulticastOp(PROC_CN_MCAST_LISTEN)) {
+    qWarning() << "Failed to subscribe to process events:"
+               << std::strerror(errno);
+    ::close(m_socket);
+    m_socket = -1;
+    return false;
+  }
+
+  m_notifier = new QSocketNotifier(m_socket, QSocketNotifier::Read, this);
+  connect(m_notifier, &QSocketNotifier::activated, this,
+          &ProcEventMonitor::onReadyRead);
+
+  qDebug() << "Listening for process events";
+  return true;
+}
+
+void ProcEventMonitor::stop() {
+  if (m_socket < 0) {
+    return;
+  }
+
+  // The kernel only sends events while someone listens
+  sendMulticastOp(PROC_CN_MCAST_IGNORE);
+
+  delete m_notifier;
+  m_notifier = nullptr;
+  ::close(m_socket);
+  m_socket = -1;
+}
+
+bool ProcEventMonitor::sendMulticastOp(int op) {
+  constexpr size_t payloadSize = sizeof(cn_msg) + sizeof(proc_cn_mcast_op);
+  alignas(nlmsghdr) char buffer[NLMSG_SPACE(payloadSize)] = {};
+
+  auto *header = reinterpret_cast<nlmsghdr *>(buffer);
+  header->nlmsg_len = NLMSG_LENGTH(payloadSize);
+  header->nlmsg_type = NLMSG_DONE;
+
+  auto *message = static_cast<cn_msg *>(NLMSG_DATA(header));
+  message->id.idx = CN_IDX_PROC;
+  message->id.val = CN_VAL_PROC;
+  message->len = sizeof(proc_cn_mcast_op);
+
+  auto mcastOp = static_cast<proc_cn_mcast_op>(op);
+  std::memcpy(message->data, &mcastOp, sizeof(mcastOp));
+
+  return ::send(m_socket, buffer, header->nlmsg_len, 0) >= 0;
+}
+
+void ProcEventMonitor::onReadyRead() {
+  alignas(nlmsghdr) char buffer[8192];
+
+  for (;;) {
+    sockaddr_nl sender = {};
+    iovec vector = {buffer, sizeof(buffer)};
+    msghdr header = {};
+    header.msg_name = &sender;
+    header.msg_namelen = sizeof(sender);
+    header.msg_iov = &vector;
+    header.msg_iovlen = 1;
+
+    ssize_t length = ::recvmsg(m_socket, &header, 0);
+    if (length < 0) {
+      if (errno == ENOBUFS) {
+        qWarning() << "Proc connector socket overflowed, rescanning processes";
+        emit overflowed();
+        continue;
+      }
+
+      // EAGAIN, everything has been read
+      return;
+    }
+
+    // Only trust events sent by the kernel itself
+    if (sender.nl_pid != 0) {
+      continue;
+    }
+
+    int remaining = static_cast<int>(length);
+    for (auto *message = reinterpret_cast<nlmsghdr *>(buffer);
+         NLMSG_OK(message, remaining);
+         message = NLMSG_NEXT(message, remaining)) {
+      if (message->nlmsg_type == NLMSG_ERROR ||
+          message->nlmsg_type == NLMSG_NOOP) {
+        continue;
+      }
+
+      auto *connectorMessage = static_cast<cn_msg *>(NLMSG_DATA(message));
+      if (connectorMessage->id.idx != CN_IDX_PROC ||
+          connectorMessage->id.val != CN_VAL_PROC ||
+          connectorMessage->len < sizeof(proc_event)) {
+        continue;
+      }
+
+      auto *event = reinterpret_cast<proc_event *>(connectorMessage->data);
+      switch (static_cast<unsigned int>(event->what)) {
+      case kEventExec:
+        emit processExecuted(event->event_data.exec.process_tgid);
+        break;
+      case kEventExit:
+        // Threads exit as well, only the group leader ends the process
+        if (event->event_data.exit.process_pid ==
+            event->event_data.exit.process_tgid) {
+          emit processExited(event->event_data.exit.process_tgid);
+        }
+        break;
+      default:
+        break;
+      }
+    }
+  }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QObject>
+
+class QSocketNotifier;
+
+// Listens for process exec and exit events of the kernel proc connector
+// (NETLINK_CONNECTOR, CN_IDX_PROC), so processes can be followed without
+// scanning /proc. Needs CAP_NET_ADMIN.
+class ProcEventMonitor : public QObject {
+  Q_OBJECT
+
+public:
+  explicit ProcEventMonitor(QObject *parent = nullptr);
+  ~ProcEventMonitor() override;
+
+  bool start();
+  void stop();
+  bool isRunning() const { return m_socket >= 0; }
+
+signals:
+  // pid is the process, i.e. thread group, id
+  void processExecuted(int pid);
+  void processExited(int pid);
+
+  // Events were dropped by the kernel, processes have to be looked up from
+  // scratch
+  void overflowed();
+
+private slots:
+  void onReadyRead();
+
+private:
+  bool sendMulticastOp(int op);
+
+  int m_socket = -1;
+  QSocketNotifier *m_notifier = nullptr;
+};
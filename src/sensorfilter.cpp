@@ -0,0 +1,111 @@
+#include "sensorfilter.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Rejection threshold in scaled MADs, 1.4826 makes the MAD a consistent
+// estimator of the standard deviation for normal noise
+constexpr double kHampelSigmas = 3.0;
+constexpr double kMadScale = 1.4826;
+} // namespace
+
+SensorFilter::SensorFilter(double minimum, double maximum,
+                           double minimumDeviation, int window,
+                           qint64 staleAfterMs)
+    : m_minimum(minimum), m_maximum(maximum),
+      m_minimumDeviation(minimumDeviation), m_window(std::max(window, 1)),
+      m_staleAfterMs(staleAfterMs) {}
+
+SensorFilter::Verdict SensorFilter::add(double raw, qint64 nowMs) {
+  if (!std::isfinite(raw) || raw < m_minimum || raw > m_maximum) {
+    return Verdict::Implausible;
+  }
+
+  // The candidate is part of the window, so a persisting level change
+  // moves the median and gets accepted
+  if (int(m_samples.size()) < m_window) {
+    m_samples.push_back(raw);
+  } else {
+    m_samples[m_next] = raw;
+  }
+  m_next = (m_next + 1) % m_window;
+
+  if (m_window >= 3 && int(m_samples.size()) == m_window) {
+    double center = median(m_samples);
+
+    std::vector<double> deviations;
+    deviations.reserve(m_samples.size());
+    for (double sample : m_samples) {
+      deviations.push_back(std::abs(sample - center));
+    }
+    double limit = std::max(kHampelSigmas * kMadScale * median(deviations),
+                            m_minimumDeviation);
+
+    if (std::abs(raw - center) > limit) {
+      return Verdict::Outlier;
+    }
+  }
+
+  m_value = raw;
+  m_lastAcceptedMs = nowMs;
+  return Verdict::Accepted;
+}
+
+void SensorFilter::overrule(double raw, qint64 nowMs) {
+  // Already part of the window, only the value follows
+  m_value = raw;
+  m_lastAcceptedMs = nowMs;
+}
+
+bool SensorFilter::isStale(qint64 nowMs) const {
+  return m_lastAcceptedMs < 0 || nowMs - m_lastAcceptedMs > m_staleAfterMs;
+}
+
+bool SensorFilter::becameStale(qint64 nowMs) {
+  bool stale = hasValue() && isStale(nowMs);
+  bool became = stale && !m_staleReported;
+  m_staleReported = stale;
+  return became;
+}
+
+void SensorFilter::reset() {
+  m_samples.clear();
+  m_next = 0;
+  m_value = 0.0;
+  m_lastAcceptedMs = -1;
+  m_staleReported = false;
+}
+
+double SensorFilter::median(std::vector<double> values) {
+  auto middle = values.begin() + values.size() / 2;
+  std::nth_element(values.begin(), middle, values.end());
+  if (values.size() % 2 == 1) {
+    return *middle;
+  }
+
+  double upper = *middle;
+  double lower = *std::max_element(values.begin(), middle);
+  return (lower + upper) / 2.0;
+}
+
+void SensorFilterCounters::count(SensorFilter::Verdict verdict) {
+  switch (verdict) {
+  case SensorFilter::Verdict::Accepted:
+    break;
+  case SensorFilter::Verdict::Implausible:
+    implausible++;
+    break;
+  case SensorFilter::Verdict::Outlier:
+    outliers++;
+    break;
+  }
+}
+
+QVariantMap SensorFilterCounters::toVariantMap() const {
+  QVariantMap counters;
+  counters["implausible"] = implausible;
+  counters["outliers"] = outliers;
+  counters["missing"] = missing;
+  counters["stale"] = stale;
+  return counters;
+}
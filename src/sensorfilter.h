@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QVariantMap>
+#include <QtGlobal>
+#include <vector>
+
+// Sits between the raw reads of one sensor and the monitor state. Samples
+// outside the physical range are dropped, a Hampel filter over the last few
+// plausible samples rejects single glitched reads, and failed reads hold the
+// last accepted value until it goes stale instead of reading as 0.
+//
+// A level change is accepted as soon as it makes up the majority of the
+// window, i.e. on its second sample with the default window of 3.
+class SensorFilter {
+public:
+  enum class Verdict {
+    Accepted,
+    Implausible, // Outside the physical range
+    Outlier      // Rejected by the Hampel filter
+  };
+
+  SensorFilter() = default;
+
+  // A window below 3 disables the outlier rejection, only the range is
+  // checked. Deviations up to minimumDeviation are never outliers, so a
+  // steady signal with a MAD of 0 still follows small changes.
+  SensorFilter(double minimum, double maximum, double minimumDeviation,
+               int window = 3, qint64 staleAfterMs = 5000);
+
+  // Failed reads are simply not added, the value is held until it is stale
+  Verdict add(double raw, qint64 nowMs);
+
+  // Accepts the sample add() just rejected as an outlier, for protection
+  // inputs where a late trip costs more than a false one
+  void overrule(double raw, qint64 nowMs);
+
+  // Last accepted value, 0 before the first one
+  double value() const { return m_value; }
+  bool hasValue() const { return m_lastAcceptedMs >= 0; }
+  bool isStale(qint64 nowMs) const;
+
+  // True once when a sensor that had a value goes stale, for counting and
+  // logging
+  bool becameStale(qint64 nowMs);
+
+  // Forgets the history, e.g. when a GPU was runtime-suspended
+  void reset();
+
+private:
+  static double median(std::vector<double> values);
+
+  double m_minimum = 0.0;
+  double m_maximum = 0.0;
+  double m_minimumDeviation = 0.0;
+  int m_window = 1;
+  qint64 m_staleAfterMs = 5000;
+
+  std::vector<double> m_samples; // Ring of the last plausible raw samples
+  int m_next = 0;
+  double m_value = 0.0;
+  qint64 m_lastAcceptedMs = -1;
+  bool m_staleReported = false;
+};
+
+// Rejection counters of all filters of a monitor
+struct SensorFilterCounters {
+  quint64 implausible = 0;
+  quint64 outliers = 0;
+  quint64 missing = 0; // Failed reads
+  quint64 stale = 0;   // Sensors that went stale
+
+  void count(SensorFilter::Verdict verdict);
+  quint64 rejected() const { return implausible + outliers; }
+  QVariantMap toVariantMap() const;
+};
@@ -1,6 +1,11 @@
 #include "systemprotector.h"
 #include <QDebug>
 
+namespace {
+// Hot spots swing by a few degrees per tick, don't toggle on every swing
+constexpr double kCpuHotspotHysteresis = 3.0;
+} // namespace
+
 SystemProtector::SystemProtector(QObject *parent) : QObject(parent) {
   m_powerMonitor = new PowerMonitor(this);
   m_cpuController = new CpuController(this);
@@ -41,13 +46,48 @@ void SystemProtector::setCooldownSeconds(int seconds) {
   emit cooldownSecondsChanged();
 }
 
+void SystemProtector::setCpuHotspotThreshold(double threshold) {
+  if (qFuzzyCompare(m_cpuHotspotThreshold, threshold))
+    return;
+
+  m_cpuHotspotThreshold = threshold;
+  emit cpuHotspotThresholdChanged();
+
+  // Re-evaluate against the last sample
+  updateCpuHotspot(m_cpuHotspotTemperature);
+}
+
+void SystemProtector::updateCpuHotspot(double temperature) {
+  m_cpuHotspotTemperature = temperature;
+
+  bool exceeded = false;
+  if (m_cpuHotspotThreshold > 0) {
+    exceeded = m_cpuHotspotExceeded
+                   ? temperature > m_cpuHotspotThreshold - kCpuHotspotHysteresis
+                   : temperature > m_cpuHotspotThreshold;
+  }
+
+  if (exceeded == m_cpuHotspotExceeded)
+    return;
+
+  m_cpuHotspotExceeded = exceeded;
+  handleThresholdChange();
+}
+
+bool SystemProtector::protectionTriggered() const {
+  return m_powerMonitor->thresholdExceeded() || m_cpuHotspotExceeded;
+}
+
 void SystemProtector::handleThresholdChange() {
   if (!m_autoProtection)
     return;
 
-  if (m_powerMonitor->thresholdExceeded()) {
+  if (protectionTriggered()) {
     // Threshold exceeded - apply limit immediately
-    qDebug() << "GPU power threshold exceeded, applying CPU frequency limit";
+    qDebug() << "Protection threshold exceeded (GPU power:"
+             << m_powerMonitor->thresholdExceeded()
+             << "CPU hot spot:" << m_cpuHotspotExceeded
+             << "), applying CPU frequency limit";
     m_cpuController->applyFrequencyLimit();
     m_limitWasAutoApplied = true;
 
@@ -56,7 +96,7 @@ void SystemProtector::handleThresholdChange() {
   } else {
     // Threshold not exceeded - only remove if limit was auto-applied
     if (m_limitWasAutoApplied) {
-      qDebug() << "GPU power below threshold, starting cooldown timer for"
+      qDebug() << "Below protection thresholds, starting cooldown timer for"
                << m_cooldownSeconds << "seconds";
       // Start cooldown timer
       m_cooldownTimer->start(m_cooldownSeconds * 1000);
@@ -66,7 +106,7 @@ void SystemProtector::handleThresholdChange() {
 
 void SystemProtector::onCooldownExpired() {
   // Only remove if threshold is still not exceeded and limit was auto-applied
-  if (!m_powerMonitor->thresholdExceeded() && m_limitWasAutoApplied) {
+  if (!protectionTriggered() && m_limitWasAutoApplied) {
     qDebug() << "Cooldown expired, removing CPU frequency limit";
     m_cpuController->removeFrequencyLimit();
     m_limitWasAutoApplied = false;
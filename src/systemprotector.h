@@ -13,6 +13,8 @@ class SystemProtector : public QObject {
                  NOTIFY autoProtectionChanged)
   Q_PROPERTY(int cooldownSeconds READ cooldownSeconds WRITE setCooldownSeconds
                  NOTIFY cooldownSecondsChanged)
+  Q_PROPERTY(double cpuHotspotThreshold READ cpuHotspotThreshold WRITE
+                 setCpuHotspotThreshold NOTIFY cpuHotspotThresholdChanged)
 
 public:
   explicit SystemProtector(QObject *parent = nullptr);
@@ -21,23 +23,35 @@ public:
   CpuController *cpuController() const { return m_cpuController; }
   bool autoProtection() const { return m_autoProtection; }
   int cooldownSeconds() const { return m_cooldownSeconds; }
+  double cpuHotspotThreshold() const { return m_cpuHotspotThreshold; }
+  bool cpuHotspotExceeded() const { return m_cpuHotspotExceeded; }
 
   void setAutoProtection(bool enabled);
   void setCooldownSeconds(int seconds);
 
+  // The hottest CPU core also triggers protection, 0 disables the trigger
+  void setCpuHotspotThreshold(double threshold);
+  void updateCpuHotspot(double temperature);
+
 private slots:
   void handleThresholdChange();
   void onCooldownExpired();
 
 private:
+  bool protectionTriggered() const;
+
   PowerMonitor *m_powerMonitor;
   CpuController *m_cpuController;
   QTimer *m_cooldownTimer;
   bool m_autoProtection = true;
   int m_cooldownSeconds = 5;
   bool m_limitWasAutoApplied = false;
+  double m_cpuHotspotThreshold = 0.0;
+  double m_cpuHotspotTemperature = 0.0;
+  bool m_cpuHotspotExceeded = false;
 
 signals:
   void autoProtectionChanged();
   void cooldownSecondsChanged();
+  void cpuHotspotThresholdChanged();
 };
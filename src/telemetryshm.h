@@ -0,0 +1,187 @@
+#pragma once
+
+// Layout of the shared-memory telemetry channel of uncrashd and a reader for
+// it. Plain C++17 without Qt, consumers only need this header.
+//
+// Get the fd with the GetTelemetryFd DBus method, then:
+//
+//   uncrash::TelemetryShmReader reader(fd);
+//   uint64_t cursor = reader.writeIndex();
+//   int power = reader.fieldIndex("gpuPower");
+//   for (;;) {
+//     reader.poll(cursor, [&](const uncrash::TelemetrySample &sample) {
+//       use(sample.timestampNs, sample.values[power]);
+//     });
+//     sleep();
+//   }
+//
+// Records are written into a ring, each protected by a sequence number: odd
+// while the daemon writes it, 2 * (index + 1) once record index is complete.
+// Readers copy a record and accept it if the sequence was the expected one
+// before and after the copy, so any number of them read lock-free and never
+// block the daemon. Readers that fall more than a ring behind lose records.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace uncrash {
+
+constexpr uint32_t kTelemetryShmMagic = 0x48534355; // "UCSH"
+constexpr uint32_t kTelemetryShmVersion = 1;
+constexpr int kTelemetryShmMaxFields = 16;
+constexpr int kTelemetryShmFieldNameSize = 32;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free &&
+                  std::atomic<uint64_t>::is_always_lock_free,
+              "The channel needs lock-free atomics to be shared");
+
+// At offset 0, records follow at headerSize
+struct TelemetryShmHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t headerSize;
+  uint32_t recordSize;
+  uint32_t capacity; // Records in the ring
+  uint32_t fieldCount;
+  uint32_t rateHz; // Most records written per second
+  uint32_t reserved;
+  char fieldNames[kTelemetryShmMaxFields][kTelemetryShmFieldNameSize];
+
+  alignas(64) std::atomic<uint64_t> writeIndex; // Records written so far
+};
+
+struct TelemetryShmRecord {
+  std::atomic<uint32_t> sequence;
+  uint32_t reserved;
+  uint64_t timestampNs; // CLOCK_MONOTONIC
+  double values[kTelemetryShmMaxFields];
+};
+
+// A consistent copy of one record
+struct TelemetrySample {
+  uint64_t index;
+  uint64_t timestampNs;
+  double values[kTelemetryShmMaxFields];
+};
+
+class TelemetryShmReader {
+public:
+  // Maps the channel read-only, the fd can be closed afterwards
+  explicit TelemetryShmReader(int fd) {
+    struct stat info;
+    if (fstat(fd, &info) != 0 ||
+        size_t(info.st_size) < sizeof(TelemetryShmHeader)) {
+      return;
+    }
+
+    void *memory =
+        mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+      return;
+    }
+    m_memory = memory;
+    m_size = size_t(info.st_size);
+
+    const TelemetryShmHeader *header = this->header();
+    if (header->magic != kTelemetryShmMagic ||
+        header->version != kTelemetryShmVersion ||
+        header->recordSize != sizeof(TelemetryShmRecord) ||
+        header->capacity == 0 ||
+        header->headerSize + size_t(header->capacity) * header->recordSize >
+            m_size) {
+      munmap(m_memory, m_size);
+      m_memory = nullptr;
+    }
+  }
+
+  ~TelemetryShmReader() {
+    if (m_memory != nullptr) {
+      munmap(m_memory, m_size);
+    }
+  }
+
+  TelemetryShmReader(const TelemetryShmReader &) = delete;
+  TelemetryShmReader &operator=(const TelemetryShmReader &) = delete;
+
+  bool isValid() const { return m_memory != nullptr; }
+
+  const TelemetryShmHeader *header() const {
+    return static_cast<const TelemetryShmHeader *>(m_memory);
+  }
+
+  // Index of a field in TelemetrySample::values, -1 if unknown
+  int fieldIndex(const char *name) const {
+    for (uint32_t i = 0; i < header()->fieldCount; i++) {
+      if (std::strncmp(header()->fieldNames[i], name,
+                       kTelemetryShmFieldNameSize) == 0) {
+        return int(i);
+      }
+    }
+    return -1;
+  }
+
+  uint64_t writeIndex() const {
+    return header()->writeIndex.load(std::memory_order_acquire);
+  }
+
+  // Copies record index, false if it is not written yet or was overwritten
+  bool read(uint64_t index, TelemetrySample &sample) const {
+    const TelemetryShmRecord &record = this->record(index);
+    uint32_t expected = uint32_t(2 * (index + 1));
+
+    uint32_t before = record.sequence.load(std::memory_order_acquire);
+    if (before != expected) {
+      return false;
+    }
+
+    sample.index = index;
+    sample.timestampNs = record.timestampNs;
+    std::memcpy(sample.values, record.values, sizeof(sample.values));
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return record.sequence.load(std::memory_order_relaxed) == expected;
+  }
+
+  // Calls callback for every record from cursor to the newest one and
+  // advances the cursor. Returns the number of records lost because the
+  // reader fell behind.
+  template <typename Callback>
+  uint64_t poll(uint64_t &cursor, Callback &&callback) const {
+    uint64_t end = writeIndex();
+    uint64_t lost = 0;
+
+    uint64_t capacity = header()->capacity;
+    if (end > capacity && cursor < end - capacity) {
+      lost = end - capacity - cursor;
+      cursor = end - capacity;
+    }
+
+    TelemetrySample sample;
+    for (; cursor < end; cursor++) {
+      if (read(cursor, sample)) {
+        callback(sample);
+      } else {
+        lost++; // Overwritten while we were behind
+      }
+    }
+    return lost;
+  }
+
+private:
+  const TelemetryShmRecord &record(uint64_t index) const {
+    const TelemetryShmHeader *header = this->header();
+    const char *records =
+        static_cast<const char *>(m_memory) + header->headerSize;
+    return reinterpret_cast<const TelemetryShmRecord *>(
+        records)[index % header->capacity];
+  }
+
+  void *m_memory = nullptr;
+  size_t m_size = 0;
+};
+
+} // namespace uncrash
@@ -5,23 +5,199 @@
 #include <QProcess>
 #include <QRegularExpression>
 #include <QTextStream>
+#include <QThreadPool>
+#include <algorithm>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+// Physical limits, samples outside are read errors (0 °C on a failed
+// read, 255 or 65535 from a confused embedded controller)
+constexpr double kMinTemperature = 1.0;   // In Celsius
+constexpr double kMaxTemperature = 150.0; // In Celsius
+
+// Changes up to this are never treated as outliers
+constexpr double kTemperatureDeviation = 5.0; // In Celsius
+} // namespace
+
+TemperatureMonitor::TemperatureMonitor(PowerMonitor *powerMonitor,
+                                       QObject *parent)
+    : QObject(parent), m_powerMonitor(powerMonitor),
+      m_gpuTemperatureFilter(kMinTemperature, kMaxTemperature,
+                             kTemperatureDeviation),
+      m_cpuTemperatureFilter(kMinTemperature, kMaxTemperature,
+                             kTemperatureDeviation),
+      m_cpuHotspotFilter(kMinTemperature, kMaxTemperature,
+                         kTemperatureDeviation),
+      m_motherboardTemperatureFilter(kMinTemperature, kMaxTemperature,
+                                     kTemperatureDeviation) {
+  m_clock.start();
+}
 
-TemperatureMonitor::TemperatureMonitor(QObject *parent)
-    : QObject(parent), m_updateTimer(new QTimer(this)) {
-  // Detect GPU vendor first
-  detectGpuVendor();
+TemperatureMonitor::~TemperatureMonitor() { closeCpuCoreSensors(); }
 
-  // Find CPU temperature hwmon (support AMD and Intel)
-  m_cpuTempPath = findHwmonByName("k10temp"); // AMD Ryzen/EPYC
-  if (m_cpuTempPath.isEmpty()) {
-    m_cpuTempPath = findHwmonByName("coretemp"); // Intel
+void TemperatureMonitor::startProbe() {
+  // GPU detection may block on nvidia-smi, so it runs concurrently with the
+  // hwmon scan instead of before it
+  redetectGpu();
+
+  QThreadPool::globalInstance()->start([this]() {
+    SensorProbe probe = findSensorHwmons();
+    QMetaObject::invokeMethod(
+        this, [this, probe]() { applySensorProbe(probe); },
+        Qt::QueuedConnection);
+  });
+}
+
+void TemperatureMonitor::redetectGpu() {
+  QThreadPool::globalInstance()->start([this]() {
+    GpuProbe probe = detectGpuVendor();
+    QMetaObject::invokeMethod(
+        this, [this, probe]() { applyGpuProbe(probe); }, Qt::QueuedConnection);
+  });
+}
+
+void TemperatureMonitor::handleUevent(const Uevent &event) {
+  if (event.action != "add" && event.action != "remove") {
+    return;
+  }
+
+  if (event.subsystem == "hwmon") {
+    // hwmon numbering is not stable, re-resolve which hwmon serves which
+    // sensor. The amdgpu, i915 and xe hwmons also identify the GPU.
+    QString name = event.properties.value("NAME");
+    if (name.isEmpty() && event.action == "add") {
+      QFile nameFile("/sys" + event.devpath + "/name");
+      if (nameFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        name = QTextStream(&nameFile).readAll().trimmed();
+      }
+    }
+
+    QString hwmonPath = "/sys/class/hwmon/" + event.devpath.section('/', -1);
+    if (name == "amdgpu" || name == "i915" || name == "xe" ||
+        hwmonPath == m_gpuHwmonPath) {
+      redetectGpu();
+    } else {
+      rebindSensorHwmons();
+    }
+  } else if (event.subsystem == "drm" &&
+             event.properties.value("DEVTYPE") == "drm_minor") {
+    // A GPU driver was loaded or unloaded, or the GPU was reset
+    redetectGpu();
+  }
+}
+
+void TemperatureMonitor::rebindSensorHwmons() {
+  SensorProbe probe = findSensorHwmons();
+
+  // Only touch the bindings that actually moved
+  bool changed = false;
+  if (probe.cpuTempPath != m_cpuTempPath) {
+    qInfo() << "CPU temperature hwmon moved from" << m_cpuTempPath << "to"
+            << probe.cpuTempPath;
+    m_cpuTempPath = probe.cpuTempPath;
+    changed = true;
+  }
+  if (probe.motherboardPath != m_motherboardPath) {
+    qInfo() << "Motherboard sensors hwmon moved from" << m_motherboardPath
+            << "to" << probe.motherboardPath;
+    m_motherboardPath = probe.motherboardPath;
+    changed = true;
+  }
+  if (probe.cpuCoreInputs != m_cpuCoreInputs) {
+    bindCpuCoreSensors(probe.cpuCoreInputs, probe.cpuCoreLabels);
+  }
+
+  if (changed && probed()) {
+    emit bindingsChanged();
   }
+}
+
+void TemperatureMonitor::applyGpuProbe(const GpuProbe &probe) {
+  m_gpuVendor = probe.vendor;
+  m_gpuName = probe.name;
+  m_gpuHwmonPath = probe.hwmonPath;
+  m_gpuRuntimePm = probe.runtimePm;
+  m_gpuProbed = true;
+
+  if (probe.vendor == "Unknown") {
+    qWarning() << "No NVIDIA, AMD or Intel GPU detected";
+  }
+
+  if (probed()) {
+    emit bindingsChanged();
+  }
+}
+
+void TemperatureMonitor::applySensorProbe(const SensorProbe &probe) {
+  m_cpuTempPath = probe.cpuTempPath;
+  m_motherboardPath = probe.motherboardPath;
+  bindCpuCoreSensors(probe.cpuCoreInputs, probe.cpuCoreLabels);
+  m_sensorsProbed = true;
+
   if (m_cpuTempPath.isEmpty()) {
-    m_cpuTempPath = findHwmonByName("zenpower"); // Alternative AMD driver
+    qWarning() << "CPU temperature hwmon not found";
+  }
+  if (m_motherboardPath.isEmpty()) {
+    qWarning() << "Motherboard sensors hwmon not found";
+  }
+
+  if (probed()) {
+    emit bindingsChanged();
+  }
+}
+
+TemperatureMonitor::SensorProbe TemperatureMonitor::findSensorHwmons() {
+  SensorProbe probe;
+
+  // Read all hwmon names in one pass instead of rescanning for every driver
+  QMap<QString, QString> hwmons = scanHwmonNames();
+
+  // Find CPU temperature hwmon (support AMD and Intel)
+  const QStringList cpuDrivers = {
+      "k10temp",  // AMD Ryzen/EPYC
+      "coretemp", // Intel
+      "zenpower"  // Alternative AMD driver
+  };
+
+  QString cpuDriver;
+  for (const QString &driver : cpuDrivers) {
+    probe.cpuTempPath = hwmons.value(driver);
+    if (!probe.cpuTempPath.isEmpty()) {
+      cpuDriver = driver;
+      break;
+    }
+  }
+
+  // The hot spots are in the per-core (coretemp, one hwmon per package) and
+  // per-CCD channels, not in the package/Tctl value of temp1
+  if (!cpuDriver.isEmpty()) {
+    static const QRegularExpression coreLabel("^(Core|Tccd)\\s*\\d+$");
+
+    for (const QString &hwmonPath : findAllHwmonByPattern(cpuDriver)) {
+      QDir dir(hwmonPath);
+      const QStringList labelFiles =
+          dir.entryList(QStringList() << "temp*_label", QDir::Files);
+      for (const QString &labelFile : labelFiles) {
+        QFile file(dir.filePath(labelFile));
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+          continue;
+        }
+
+        QString label = QTextStream(&file).readAll().trimmed();
+        if (coreLabel.match(label).hasMatch()) {
+          QString input = labelFile;
+          input.replace("_label", "_input");
+          probe.cpuCoreInputs.append(dir.filePath(input));
+          probe.cpuCoreLabels.append(label);
+        }
+      }
+    }
   }
 
   // Find motherboard sensor hwmon (support various chipsets)
-  QStringList motherboardDrivers = {
+  const QStringList motherboardDrivers = {
       "asus_wmi_sensors", // ASUS motherboards
       "gigabyte_wmi",     // Gigabyte motherboards (WMI interface)
       "nct6775",          // Nuvoton NCT6775/6776/6779
@@ -32,47 +208,30 @@ TemperatureMonitor::TemperatureMonitor(QObject *parent)
   };
 
   for (const QString &driver : motherboardDrivers) {
-    m_motherboardPath = findHwmonByName(driver);
-    if (!m_motherboardPath.isEmpty()) {
+    probe.motherboardPath = hwmons.value(driver);
+    if (!probe.motherboardPath.isEmpty()) {
       qDebug() << "Found motherboard sensors:" << driver << "at"
-               << m_motherboardPath;
+               << probe.motherboardPath;
       break;
     }
   }
 
-  // For AMD GPUs, find the GPU hwmon
-  if (m_gpuVendor == "AMD") {
-    // AMD GPUs typically use amdgpu driver
-    QStringList amdPaths = findAllHwmonByPattern("amdgpu");
-    if (!amdPaths.isEmpty()) {
-      m_gpuHwmonPath = amdPaths.first();
-      qDebug() << "Found AMD GPU hwmon at" << m_gpuHwmonPath;
-    }
-  }
-
-  if (m_cpuTempPath.isEmpty()) {
-    qWarning() << "CPU temperature hwmon not found";
-  }
-  if (m_motherboardPath.isEmpty()) {
-    qWarning() << "Motherboard sensors hwmon not found";
-  }
-
-  connect(m_updateTimer, &QTimer::timeout, this,
-          &TemperatureMonitor::updateSensors);
-}
-
-void TemperatureMonitor::startMonitoring(int intervalMs) {
-  updateSensors(); // Immediate first update
-  m_updateTimer->start(intervalMs);
+  return probe;
 }
 
-void TemperatureMonitor::stopMonitoring() { m_updateTimer->stop(); }
-
 void TemperatureMonitor::updateSensors() {
   bool changed = false;
+  qint64 now = m_clock.elapsed();
 
-  // Update GPU sensors
+  // Update GPU sensors. A suspended GPU really is idle, and Intel GPUs may
+  // have no temperature channel at all.
   SensorData newGpuData = readGpuSensors();
+  if (m_gpuSuspended || m_gpuSampleShared ||
+      (m_gpuVendor == "Intel" && newGpuData.temperature <= 0)) {
+    m_gpuTemperatureFilter.reset();
+  } else {
+    filterTemperature(m_gpuTemperatureFilter, newGpuData, "GPU", now);
+  }
   if (newGpuData.valid && (newGpuData.temperature != m_gpuData.temperature ||
                            newGpuData.fanSpeed != m_gpuData.fanSpeed)) {
     m_gpuData = newGpuData;
@@ -82,14 +241,23 @@ void TemperatureMonitor::updateSensors() {
 
   // Update CPU sensors
   SensorData newCpuData = readCpuSensors();
+  filterTemperature(m_cpuTemperatureFilter, newCpuData, "CPU", now);
   if (newCpuData.valid && newCpuData.temperature != m_cpuData.temperature) {
     m_cpuData = newCpuData;
     emit cpuTemperatureChanged(m_cpuData.temperature);
     changed = true;
   }
 
+  // Update per-core hot spots
+  if (readCpuCoreSensors()) {
+    emit cpuHotspotChanged();
+    changed = true;
+  }
+
   // Update motherboard sensors
   SensorData newMoboData = readMotherboardSensors();
+  filterTemperature(m_motherboardTemperatureFilter, newMoboData,
+                    "motherboard", now);
   if (newMoboData.valid &&
       newMoboData.temperature != m_motherboardData.temperature) {
     m_motherboardData = newMoboData;
@@ -105,49 +273,73 @@ void TemperatureMonitor::updateSensors() {
   }
 }
 
-SensorData TemperatureMonitor::readGpuSensors() {
-  if (m_gpuVendor == "NVIDIA") {
-    return readNvidiaGpu();
-  } else if (m_gpuVendor == "AMD") {
-    return readAmdGpu();
+void TemperatureMonitor::filterTemperature(SensorFilter &filter,
+                                           SensorData &data, const char *name,
+                                           qint64 nowMs) {
+  if (data.valid) {
+    m_filterCounters.count(filter.add(data.temperature, nowMs));
+  } else if (filter.hasValue()) {
+    m_filterCounters.missing++;
   }
 
-  SensorData data;
-  return data;
-}
+  if (filter.becameStale(nowMs)) {
+    m_filterCounters.stale++;
+    qWarning() << "The" << name << "temperature reading is stale";
+  }
 
-SensorData TemperatureMonitor::readNvidiaGpu() {
-  SensorData data;
+  // Rejected and failed reads hold the last accepted value until it is
+  // stale
+  data.temperature = filter.value();
+  data.valid = !filter.isStale(nowMs);
+}
 
-  QProcess process;
-  process.start("nvidia-smi", QStringList()
-                                  << "--query-gpu=temperature.gpu,fan.speed"
-                                  << "--format=csv,noheader,nounits");
+SensorData TemperatureMonitor::readGpuSensors() {
+  // Never wake up a runtime-suspended GPU, report it as idle instead
+  m_gpuSuspended = m_gpuRuntimePm.isSuspended();
+  m_gpuSampleShared = false;
+  if (m_gpuSuspended) {
+    SensorData data;
+    data.valid = true;
+    m_gpuFanPercent = 0;
+    return data;
+  }
 
-  if (!process.waitForFinished(1000)) {
+  SensorData data;
+  if (readPowerMonitorGpu(&data)) {
+    m_gpuSampleShared = true;
     return data;
   }
 
-  QString output = process.readAllStandardOutput().trimmed();
-  QStringList parts = output.split(',');
+  // NVIDIA GPUs are only sampled by PowerMonitor, a second nvidia-smi
+  // process per tick for the same values is not worth it
+  if (m_gpuVendor == "AMD") {
+    return readAmdGpu();
+  } else if (m_gpuVendor == "Intel") {
+    return readIntelGpu();
+  }
 
-  if (parts.size() >= 2) {
-    bool ok;
-    double temp = parts[0].trimmed().toDouble(&ok);
-    if (ok) {
-      data.temperature = temp;
-      data.valid = true;
+  return SensorData();
+}
+
+bool TemperatureMonitor::readPowerMonitorGpu(SensorData *data) {
+  QString id = m_gpuRuntimePm.pciAddress();
+  const QList<GpuDeviceStatus> devices = m_powerMonitor->devices();
+  for (const GpuDeviceStatus &device : devices) {
+    if (device.id != id || device.state != "active") {
+      continue;
     }
 
-    int fanPercent = parts[1].trimmed().toInt(&ok);
-    if (ok) {
-      m_gpuFanPercent = fanPercent;
-      // Store percentage for NVIDIA (RPM not available via nvidia-smi)
-      data.fanSpeed = fanPercent;
+    data->temperature = device.temperature;
+    data->fanSpeed = device.fanSpeed;
+    data->valid = device.temperature > 0 || m_gpuVendor == "Intel";
+
+    // nvidia-smi reports the fan in percent (RPM not available)
+    if (m_gpuVendor == "NVIDIA") {
+      m_gpuFanPercent = device.fanSpeed;
     }
+    return data->valid;
   }
-
-  return data;
+  return false;
 }
 
 SensorData TemperatureMonitor::readAmdGpu() {
@@ -157,7 +349,9 @@ SensorData TemperatureMonitor::readAmdGpu() {
     return data;
   }
 
-  // AMD GPU temperature is typically in temp1_input
+  // Only reached while PowerMonitor has no sample of the GPU, its
+  // gpu_metrics read already covers temperature and fan speed otherwise.
+  // AMD GPU temperature is typically in temp1_input.
   double temp = readHwmonTemp(m_gpuHwmonPath, "temp1_input");
   if (temp > 0) {
     data.temperature = temp;
@@ -170,19 +364,33 @@ SensorData TemperatureMonitor::readAmdGpu() {
     data.fanSpeed = fanSpeed;
   }
 
-  // Try to read fan percentage if available (pwm1)
-  QString pwmPath = m_gpuHwmonPath + "/pwm1";
-  QFile pwmFile(pwmPath);
-  if (pwmFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-    QString value = QTextStream(&pwmFile).readAll().trimmed();
-    bool ok;
-    int pwmValue = value.toInt(&ok);
-    if (ok) {
-      // PWM is typically 0-255, convert to percentage
-      m_gpuFanPercent = (pwmValue * 100) / 255;
+  return data;
+}
+
+SensorData TemperatureMonitor::readIntelGpu() {
+  SensorData data;
+
+  if (m_gpuHwmonPath.isEmpty()) {
+    return data;
+  }
+
+  // xe reports the package in temp2 and VRAM in temp3, i915 only has a
+  // temperature on newer kernels
+  for (const QString &tempFile : {"temp1_input", "temp2_input"}) {
+    double temp = readHwmonTemp(m_gpuHwmonPath, tempFile);
+    if (temp > 0) {
+      data.temperature = temp;
+      break;
     }
   }
 
+  int fanSpeed = readHwmonFan(m_gpuHwmonPath, "fan1_input");
+  if (fanSpeed > 0) {
+    data.fanSpeed = fanSpeed;
+  }
+
+  // The power reading works without any temperature channel
+  data.valid = true;
   return data;
 }
 
@@ -228,6 +436,98 @@ SensorData TemperatureMonitor::readCpuSensors() {
   return data;
 }
 
+bool TemperatureMonitor::readCpuCoreSensors() {
+  if (m_cpuCoreFds.isEmpty()) {
+    return false;
+  }
+
+  char buffer[16];
+  for (int i = 0; i < m_cpuCoreFds.size(); ++i) {
+    m_cpuCoreTemperatures[i] = 0.0;
+    if (m_cpuCoreFds[i] < 0) {
+      continue;
+    }
+
+    ssize_t length = ::pread(m_cpuCoreFds[i], buffer, sizeof(buffer) - 1, 0);
+    if (length > 0) {
+      buffer[length] = '\0';
+      double temperature = std::atoi(buffer) / 1000.0;
+      if (temperature >= kMinTemperature && temperature <= kMaxTemperature) {
+        m_cpuCoreTemperatures[i] = temperature;
+      } else {
+        m_filterCounters.implausible++;
+      }
+    }
+  }
+
+  // One pass for max, mean and argmax. Unreadable channels are 0 and drop
+  // out of the mean without a branch.
+  const double *temperatures = m_cpuCoreTemperatures.data();
+  const int count = int(m_cpuCoreTemperatures.size());
+  double hotspot = 0.0;
+  double sum = 0.0;
+  int validCount = 0;
+  int hottest = -1;
+  for (int i = 0; i < count; ++i) {
+    double temperature = temperatures[i];
+    sum += temperature;
+    validCount += temperature > 0.0;
+    if (temperature > hotspot) {
+      hotspot = temperature;
+      hottest = i;
+    }
+  }
+
+  double mean = validCount > 0 ? sum / validCount : 0.0;
+
+  // The hot spot is a protection input, a glitched core must not trip it.
+  // A rejected hot spot keeps the previous one and its core.
+  if (hottest >= 0) {
+    SensorFilter::Verdict verdict =
+        m_cpuHotspotFilter.add(hotspot, m_clock.elapsed());
+    m_filterCounters.count(verdict);
+    if (verdict != SensorFilter::Verdict::Accepted) {
+      hotspot = m_cpuHotspotTemperature;
+      hottest = m_cpuHottestCore;
+    }
+  }
+  if (hotspot == m_cpuHotspotTemperature &&
+      mean == m_cpuCoreMeanTemperature && hottest == m_cpuHottestCore) {
+    return false;
+  }
+
+  m_cpuHotspotTemperature = hotspot;
+  m_cpuCoreMeanTemperature = mean;
+  m_cpuHottestCore = hottest;
+  return true;
+}
+
+void TemperatureMonitor::bindCpuCoreSensors(const QStringList &inputs,
+                                            const QStringList &labels) {
+  closeCpuCoreSensors();
+
+  m_cpuCoreInputs = inputs;
+  m_cpuCoreLabels = labels;
+  for (const QString &input : inputs) {
+    QByteArray path = input.toLocal8Bit();
+    m_cpuCoreFds.append(::open(path.constData(), O_RDONLY | O_CLOEXEC));
+  }
+  m_cpuCoreTemperatures.assign(inputs.size(), 0.0);
+
+  if (!inputs.isEmpty()) {
+    qDebug() << "Sampling" << inputs.size() << "per-core CPU temperatures";
+  }
+}
+
+void TemperatureMonitor::closeCpuCoreSensors() {
+  for (int fd : std::as_const(m_cpuCoreFds)) {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+  m_cpuCoreFds.clear();
+}
+
 SensorData TemperatureMonitor::readMotherboardSensors() {
   SensorData data;
 
@@ -342,7 +642,8 @@ int TemperatureMonitor::readHwmonFan(const QString &hwmonPath,
   return 0;
 }
 
-QString TemperatureMonitor::findHwmonByName(const QString &name) {
+QMap<QString, QString> TemperatureMonitor::scanHwmonNames() {
+  QMap<QString, QString> result;
   QDir hwmonDir("/sys/class/hwmon");
   QStringList hwmons = hwmonDir.entryList(QStringList() << "hwmon*",
                                           QDir::Dirs | QDir::NoDotAndDotDot);
@@ -353,13 +654,15 @@ QString TemperatureMonitor::findHwmonByName(const QString &name) {
 
     if (nameFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
       QString hwmonName = QTextStream(&nameFile).readAll().trimmed();
-      if (hwmonName == name) {
-        return hwmonDir.absoluteFilePath(hwmon);
+
+      // Keep the first hwmon of every driver
+      if (!result.contains(hwmonName)) {
+        result.insert(hwmonName, hwmonDir.absoluteFilePath(hwmon));
       }
     }
   }
 
-  return QString();
+  return result;
 }
 
 QStringList TemperatureMonitor::findAllHwmonByPattern(const QString &pattern) {
@@ -395,8 +698,41 @@ QString TemperatureMonitor::readHwmonLabel(const QString &hwmonPath,
   return QTextStream(&file).readAll().trimmed();
 }
 
-void TemperatureMonitor::detectGpuVendor() {
-  // Try NVIDIA first
+QString TemperatureMonitor::readNvidiaProcModel(const QString &pciAddress) {
+  QFile file(
+      QString("/proc/driver/nvidia/gpus/%1/information").arg(pciAddress));
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    return QString();
+  }
+
+  QTextStream in(&file);
+  while (!in.atEnd()) {
+    QString line = in.readLine();
+    if (line.startsWith("Model:")) {
+      return line.mid(6).trimmed();
+    }
+  }
+
+  return QString();
+}
+
+TemperatureMonitor::GpuProbe TemperatureMonitor::detectGpuVendor() {
+  GpuProbe probe;
+
+  // Try NVIDIA first, nvidia-smi would wake up a runtime-suspended dGPU, so
+  // take the name from the driver's procfs entry in that case
+  GpuRuntimePm nvidiaRuntimePm = GpuRuntimePm::findByVendor("0x10de");
+  if (nvidiaRuntimePm.isSuspended()) {
+    probe.vendor = "NVIDIA";
+    probe.name = readNvidiaProcModel(nvidiaRuntimePm.pciAddress());
+    if (probe.name.isEmpty()) {
+      probe.name = "NVIDIA GPU";
+    }
+    probe.runtimePm = nvidiaRuntimePm;
+    qDebug() << "Detected suspended NVIDIA GPU:" << probe.name;
+    return probe;
+  }
+
   QProcess nvidiaCheck;
   nvidiaCheck.start("nvidia-smi", QStringList() << "--query-gpu=name"
                                                 << "--format=csv,noheader");
@@ -404,17 +740,23 @@ void TemperatureMonitor::detectGpuVendor() {
   if (nvidiaCheck.waitForFinished(1000)) {
     QString output = nvidiaCheck.readAllStandardOutput().trimmed();
     if (!output.isEmpty() && nvidiaCheck.exitCode() == 0) {
-      m_gpuVendor = "NVIDIA";
-      m_gpuName = output;
-      qDebug() << "Detected NVIDIA GPU:" << m_gpuName;
-      return;
+      probe.vendor = "NVIDIA";
+      probe.name = output;
+      probe.runtimePm = nvidiaRuntimePm;
+      qDebug() << "Detected NVIDIA GPU:" << probe.name;
+      return probe;
     }
   }
 
   // Try AMD
   QStringList amdPaths = findAllHwmonByPattern("amdgpu");
   if (!amdPaths.isEmpty()) {
-    m_gpuVendor = "AMD";
+    probe.vendor = "AMD";
+
+    // AMD GPUs typically use amdgpu driver
+    probe.hwmonPath = amdPaths.first();
+    probe.runtimePm = GpuRuntimePm(probe.hwmonPath + "/device");
+    qDebug() << "Found AMD GPU hwmon at" << probe.hwmonPath;
 
     // Try to get GPU name from sysfs
     QDir drmDir("/sys/class/drm");
@@ -430,21 +772,42 @@ void TemperatureMonitor::detectGpuVendor() {
       }
 
       if (nameFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        m_gpuName = QTextStream(&nameFile).readAll().trimmed();
-        if (!m_gpuName.isEmpty()) {
-          qDebug() << "Detected AMD GPU:" << m_gpuName;
-          return;
+        probe.name = QTextStream(&nameFile).readAll().trimmed();
+        if (!probe.name.isEmpty()) {
+          qDebug() << "Detected AMD GPU:" << probe.name;
+          return probe;
         }
       }
     }
 
-    m_gpuName = "AMD GPU";
+    probe.name = "AMD GPU";
     qDebug() << "Detected AMD GPU (name unavailable)";
-    return;
+    return probe;
+  }
+
+  // Try Intel discrete GPUs (Arc, Battlemage), only dGPUs have a hwmon
+  QMap<QString, QString> hwmons = scanHwmonNames();
+  QString intelPath = hwmons.value("xe", hwmons.value("i915"));
+  if (!intelPath.isEmpty()) {
+    probe.vendor = "Intel";
+    probe.hwmonPath = intelPath;
+    probe.runtimePm = GpuRuntimePm(probe.hwmonPath + "/device");
+
+    // There is no model name in sysfs, identify the card by its PCI id
+    QFile deviceFile(probe.hwmonPath + "/device/device");
+    QString deviceId;
+    if (deviceFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+      deviceId = QTextStream(&deviceFile).readAll().trimmed();
+    }
+    probe.name = deviceId.isEmpty()
+                     ? QString("Intel GPU")
+                     : QString("Intel GPU [%1]").arg(deviceId);
+    qDebug() << "Detected Intel GPU:" << probe.name << "at" << probe.hwmonPath;
+    return probe;
   }
 
   // No GPU detected
-  m_gpuVendor = "Unknown";
-  m_gpuName = "No GPU detected";
-  qWarning() << "No NVIDIA or AMD GPU detected";
+  probe.vendor = "Unknown";
+  probe.name = "No GPU detected";
+  return probe;
 }
@@ -1,9 +1,15 @@
 #pragma once
 
+#include "gpuruntimepm.h"
+#include "powermonitor.h"
+#include "sensorfilter.h"
+#include "ueventmonitor.h"
+#include <QElapsedTimer>
 #include <QMap>
 #include <QObject>
 #include <QString>
-#include <QTimer>
+#include <QStringList>
+#include <vector>
 
 struct SensorData {
   double temperature = 0.0; // In Celsius
@@ -15,18 +21,28 @@ class TemperatureMonitor : public QObject {
   Q_OBJECT
 
 public:
-  explicit TemperatureMonitor(QObject *parent = nullptr);
-  ~TemperatureMonitor() override = default;
+  // GPU temperatures and fans are taken from the samples of powerMonitor,
+  // which reads every GPU on each power tick anyway
+  explicit TemperatureMonitor(PowerMonitor *powerMonitor,
+                              QObject *parent = nullptr);
+  ~TemperatureMonitor() override;
 
   // GPU sensors
   double gpuTemperature() const { return m_gpuData.temperature; }
   int gpuFanSpeed() const { return m_gpuData.fanSpeed; }
-  int gpuFanPercent() const { return m_gpuFanPercent; }
+  int gpuFanPercent() const { return m_gpuFanPercent; } // NVIDIA only
 
   // CPU sensors
   double cpuTemperature() const { return m_cpuData.temperature; }
   int cpuFanSpeed() const { return m_cpuData.fanSpeed; }
 
+  // Reduction over the per-core (coretemp) or per-CCD (k10temp, zenpower)
+  // channels, the hottest core is an index into cpuCoreLabels() or -1
+  double cpuHotspotTemperature() const { return m_cpuHotspotTemperature; }
+  double cpuCoreMeanTemperature() const { return m_cpuCoreMeanTemperature; }
+  int cpuHottestCore() const { return m_cpuHottestCore; }
+  QStringList cpuCoreLabels() const { return m_cpuCoreLabels; }
+
   // Case/Motherboard sensors
   double motherboardTemperature() const {
     return m_motherboardData.temperature;
@@ -40,34 +56,79 @@ public:
   QString gpuVendor() const { return m_gpuVendor; }
   QString gpuName() const { return m_gpuName; }
 
-  void startMonitoring(int intervalMs = 2000);
-  void stopMonitoring();
+  // Samples rejected by the temperature filters
+  SensorFilterCounters filterCounters() const { return m_filterCounters; }
+
+  // Motherboard sensor hwmon, also used for fan control
+  QString motherboardHwmonPath() const { return m_motherboardPath; }
+
+  // Detects the GPU and the sensor hwmons on worker threads, so nothing
+  // blocks on nvidia-smi or hwmon scans. Sensors read as invalid until the
+  // results are applied and bindingsChanged() is emitted.
+  void startProbe();
+  bool probed() const { return m_gpuProbed && m_sensorsProbed; }
+
+  // Rebuilds the bindings affected by a hwmon or drm add/remove event
+  void handleUevent(const Uevent &event);
+
+public slots:
+  // Called by the daemon's tick scheduler
+  void updateSensors();
 
 signals:
   void temperaturesUpdated();
   void gpuTemperatureChanged(double temperature);
   void cpuTemperatureChanged(double temperature);
+  void cpuHotspotChanged();
   void motherboardTemperatureChanged(double temperature);
   void fanSpeedsChanged();
-
-private slots:
-  void updateSensors();
+  void bindingsChanged();
 
 private:
+  struct GpuProbe {
+    QString vendor; // "NVIDIA", "AMD", "Intel" or "Unknown"
+    QString name;
+    QString hwmonPath;
+    GpuRuntimePm runtimePm;
+  };
+
+  struct SensorProbe {
+    QString cpuTempPath;
+    QString motherboardPath;
+    QStringList cpuCoreInputs; // tempN_input of every "Core N"/"TccdN"
+    QStringList cpuCoreLabels;
+  };
+
   // Helper methods
   SensorData readGpuSensors();
-  SensorData readNvidiaGpu();
+  bool readPowerMonitorGpu(SensorData *data);
   SensorData readAmdGpu();
+  SensorData readIntelGpu();
   SensorData readCpuSensors();
+  bool readCpuCoreSensors();
+  void bindCpuCoreSensors(const QStringList &inputs, const QStringList &labels);
+  void closeCpuCoreSensors();
   SensorData readMotherboardSensors();
   void readFanSensors();
-  void detectGpuVendor();
+  void filterTemperature(SensorFilter &filter, SensorData &data,
+                         const char *name, qint64 nowMs);
+
+  // Probes run on worker threads and must not touch any members
+  static GpuProbe detectGpuVendor();
+  static SensorProbe findSensorHwmons();
+  void applyGpuProbe(const GpuProbe &probe);
+  void applySensorProbe(const SensorProbe &probe);
+  void redetectGpu();
+  void rebindSensorHwmons();
 
   double readHwmonTemp(const QString &hwmonPath, const QString &tempFile);
   int readHwmonFan(const QString &hwmonPath, const QString &fanFile);
-  QString findHwmonByName(const QString &name);
-  QStringList findAllHwmonByPattern(const QString &pattern);
+  static QMap<QString, QString> scanHwmonNames();
+  static QStringList findAllHwmonByPattern(const QString &pattern);
   QString readHwmonLabel(const QString &hwmonPath, const QString &labelFile);
+  static QString readNvidiaProcModel(const QString &pciAddress);
+
+  PowerMonitor *m_powerMonitor;
 
   // Sensor data
   SensorData m_gpuData;
@@ -79,14 +140,36 @@ private:
   QMap<QString, int> m_caseFanSpeeds;
 
   // GPU info
-  QString m_gpuVendor; // "NVIDIA", "AMD", or "Unknown"
+  QString m_gpuVendor; // "NVIDIA", "AMD", "Intel" or "Unknown"
   QString m_gpuName;
+  GpuRuntimePm m_gpuRuntimePm; // Checked before every GPU sample
 
   // Hwmon paths (cached for performance)
   QString m_cpuTempPath;  // CPU temperature (k10temp, coretemp, etc.)
-  QString m_gpuHwmonPath; // AMD GPU hwmon path (if AMD)
+  QString m_gpuHwmonPath; // AMD or Intel GPU hwmon path
   QString
       m_motherboardPath; // Motherboard sensors (asus_wmi, nct6775, it87, etc.)
 
-  QTimer *m_updateTimer;
+  // Per-core/per-CCD channels, temperatures are kept contiguous so the
+  // reduction is a single pass
+  QStringList m_cpuCoreInputs;
+  QStringList m_cpuCoreLabels;
+  QList<int> m_cpuCoreFds;
+  std::vector<double> m_cpuCoreTemperatures;
+  double m_cpuHotspotTemperature = 0.0;
+  double m_cpuCoreMeanTemperature = 0.0;
+  int m_cpuHottestCore = -1;
+
+  // Raw temperatures go through these before they reach the state
+  SensorFilter m_gpuTemperatureFilter;
+  SensorFilter m_cpuTemperatureFilter;
+  SensorFilter m_cpuHotspotFilter;
+  SensorFilter m_motherboardTemperatureFilter;
+  SensorFilterCounters m_filterCounters;
+  QElapsedTimer m_clock;
+  bool m_gpuSuspended = false;
+  bool m_gpuSampleShared = false; // Already filtered by PowerMonitor
+
+  bool m_gpuProbed = false;
+  bool m_sensorsProbed = false;
 };
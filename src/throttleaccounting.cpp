@@ -0,0 +1,266 @@
+#include "throttleaccounting.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+// One hour in minutes and one day in hours
+constexpr int kHourBuckets = 60;
+constexpr qint64 kHourBucketMs = 60 * 1000;
+constexpr int kDayBuckets = 24;
+constexpr qint64 kDayBucketMs = 60 * 60 * 1000;
+
+// The state lives on tmpfs, a crash loses at most this much
+constexpr qint64 kSaveIntervalMs = 60 * 1000;
+} // namespace
+
+void ThrottleTotals::add(const ThrottleTotals &other) {
+  sampledSeconds += other.sampledSeconds;
+  throttledSeconds += other.throttledSeconds;
+  frequencySecondsLost += other.frequencySecondsLost;
+  engagements += other.engagements;
+  longestEngagementSeconds =
+      std::max(longestEngagementSeconds, other.longestEngagementSeconds);
+  stallSeconds += other.stallSeconds;
+  throttledStallSeconds += other.throttledStallSeconds;
+}
+
+QVariantMap ThrottleTotals::toVariantMap() const {
+  QVariantMap totals;
+  totals["sampledSeconds"] = sampledSeconds;
+  totals["throttledSeconds"] = throttledSeconds;
+  totals["frequencySecondsLost"] = frequencySecondsLost;
+  totals["engagements"] = engagements;
+  totals["longestEngagementSeconds"] = longestEngagementSeconds;
+  totals["stallSeconds"] = stallSeconds;
+  totals["throttledStallSeconds"] = throttledStallSeconds;
+
+  // Share of the time the CPU stalled, inside and outside the limit
+  double unthrottledSeconds = sampledSeconds - throttledSeconds;
+  totals["throttledStallRatio"] =
+      throttledSeconds > 0 ? throttledStallSeconds / throttledSeconds : 0.0;
+  totals["unthrottledStallRatio"] =
+      unthrottledSeconds > 0
+          ? (stallSeconds - throttledStallSeconds) / unthrottledSeconds
+          : 0.0;
+  return totals;
+}
+
+ThrottleTotals ThrottleTotals::fromVariantMap(const QVariantMap &totals) {
+  ThrottleTotals parsed;
+  parsed.sampledSeconds = totals.value("sampledSeconds").toDouble();
+  parsed.throttledSeconds = totals.value("throttledSeconds").toDouble();
+  parsed.frequencySecondsLost =
+      totals.value("frequencySecondsLost").toDouble();
+  parsed.engagements = totals.value("engagements").toInt();
+  parsed.longestEngagementSeconds =
+      totals.value("longestEngagementSeconds").toDouble();
+  parsed.stallSeconds = totals.value("stallSeconds").toDouble();
+  parsed.throttledStallSeconds =
+      totals.value("throttledStallSeconds").toDouble();
+  return parsed;
+}
+
+RollingTotals::RollingTotals(int bucketCount, qint64 bucketMs)
+    : m_buckets(bucketCount), m_bucketMs(bucketMs) {}
+
+void RollingTotals::add(qint64 nowMs, const ThrottleTotals &delta) {
+  qint64 index = nowMs / m_bucketMs;
+  Bucket &bucket = m_buckets[index % m_buckets.size()];
+
+  // Reuse the slot of a bucket that fell out of the window
+  if (bucket.index != index) {
+    bucket.index = index;
+    bucket.totals = ThrottleTotals();
+  }
+  bucket.totals.add(delta);
+}
+
+ThrottleTotals RollingTotals::sum(qint64 nowMs) const {
+  qint64 oldest = nowMs / m_bucketMs - qint64(m_buckets.size()) + 1;
+
+  ThrottleTotals totals;
+  for (const Bucket &bucket : m_buckets) {
+    if (bucket.index >= oldest) {
+      totals.add(bucket.totals);
+    }
+  }
+  return totals;
+}
+
+ThrottleAccounting::ThrottleAccounting(CpuController *cpuController,
+                                       QObject *parent)
+    : QObject(parent), m_cpuController(cpuController),
+      m_lastHour(kHourBuckets, kHourBucketMs),
+      m_lastDay(kDayBuckets, kDayBucketMs) {
+  m_clock.start();
+
+  m_pressureFd = ::open("/proc/pressure/cpu", O_RDONLY | O_CLOEXEC);
+  if (m_pressureFd < 0) {
+    qInfo() << "No /proc/pressure/cpu, throttling is accounted without "
+               "stall times";
+  }
+}
+
+ThrottleAccounting::~ThrottleAccounting() {
+  saveState();
+
+  if (m_pressureFd >= 0) {
+    ::close(m_pressureFd);
+  }
+}
+
+void ThrottleAccounting::setStatePath(const QString &path) {
+  m_statePath = path;
+  m_bootId = readBootId();
+  if (m_bootId.isEmpty()) {
+    qWarning() << "No boot_id, throttle totals start over with the daemon";
+    return;
+  }
+
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return;
+  }
+
+  QVariantMap state =
+      QJsonDocument::fromJson(file.readAll()).toVariant().toMap();
+  if (state.value("bootId").toString() != m_bootId) {
+    qInfo() << "Throttle totals in" << path << "are from an earlier boot";
+    return;
+  }
+
+  // Added to what was accounted before the state was read
+  m_bootTotals.add(
+      ThrottleTotals::fromVariantMap(state.value("boot").toMap()));
+  qInfo() << "Throttle totals of this boot restored from" << path;
+}
+
+void ThrottleAccounting::saveState() {
+  if (m_statePath.isEmpty() || m_bootId.isEmpty()) {
+    return;
+  }
+
+  QVariantMap state;
+  state["bootId"] = m_bootId;
+  state["boot"] = m_bootTotals.toVariantMap();
+
+  QDir().mkpath(QFileInfo(m_statePath).absolutePath());
+  QSaveFile file(m_statePath);
+  if (!file.open(QIODevice::WriteOnly) ||
+      file.write(QJsonDocument::fromVariant(state).toJson(
+          QJsonDocument::Compact)) < 0 ||
+      !file.commit()) {
+    qWarning() << "Failed to save throttle totals to" << m_statePath;
+  }
+}
+
+QString ThrottleAccounting::readBootId() {
+  QFile file("/proc/sys/kernel/random/boot_id");
+  if (!file.open(QIODevice::ReadOnly)) {
+    return QString();
+  }
+  return QString::fromLatin1(file.readAll().trimmed());
+}
+
+void ThrottleAccounting::sample() {
+  qint64 now = m_clock.elapsed();
+  qint64 stallUs = readCpuStallMicroseconds();
+
+  // The interval since the last sample is accounted with the state sampled
+  // back then
+  if (m_lastSampleMs >= 0) {
+    ThrottleTotals delta;
+    double seconds = (now - m_lastSampleMs) / 1000.0;
+    double stallSeconds = stallUs >= 0 && m_lastStallUs >= 0
+                              ? (stallUs - m_lastStallUs) / 1000000.0
+                              : 0.0;
+
+    delta.sampledSeconds = seconds;
+    delta.stallSeconds = stallSeconds;
+    if (m_engaged) {
+      delta.throttledSeconds = seconds;
+      delta.frequencySecondsLost = m_lostGHz * seconds;
+      delta.throttledStallSeconds = stallSeconds;
+    }
+
+    // Engagements count when they start, their length when they end
+    bool engaged = m_cpuController->cpuLimitApplied();
+    if (engaged && !m_engaged) {
+      delta.engagements = 1;
+      m_engagementStartMs = now;
+    } else if (!engaged && m_engaged) {
+      delta.longestEngagementSeconds = (now - m_engagementStartMs) / 1000.0;
+    }
+
+    account(now, delta);
+  } else if (m_cpuController->cpuLimitApplied()) {
+    // Already engaged when the accounting started
+    ThrottleTotals delta;
+    delta.engagements = 1;
+    m_engagementStartMs = now;
+    account(now, delta);
+  }
+
+  // The restored ceiling is what removing the limit gives back
+  m_engaged = m_cpuController->cpuLimitApplied();
+  m_lostGHz = std::max(0.0, m_cpuController->hardwareMaxFrequency() -
+                                m_cpuController->currentMaxFrequency());
+  m_lastStallUs = stallUs;
+  m_lastSampleMs = now;
+
+  if (now - m_lastSaveMs >= kSaveIntervalMs) {
+    m_lastSaveMs = now;
+    saveState();
+  }
+}
+
+void ThrottleAccounting::account(qint64 nowMs, const ThrottleTotals &delta) {
+  m_bootTotals.add(delta);
+  m_lastHour.add(nowMs, delta);
+  m_lastDay.add(nowMs, delta);
+}
+
+QVariantMap ThrottleAccounting::report() const {
+  qint64 now = m_clock.elapsed();
+
+  QVariantMap report;
+  report["boot"] = m_bootTotals.toVariantMap();
+  report["lastHour"] = m_lastHour.sum(now).toVariantMap();
+  report["lastDay"] = m_lastDay.sum(now).toVariantMap();
+  report["engaged"] = m_engaged;
+  report["currentEngagementSeconds"] =
+      m_engaged ? (now - m_engagementStartMs) / 1000.0 : 0.0;
+  report["pressureAvailable"] = m_pressureFd >= 0;
+  return report;
+}
+
+qint64 ThrottleAccounting::readCpuStallMicroseconds() {
+  if (m_pressureFd < 0) {
+    return -1;
+  }
+
+  // "some avg10=0.00 avg60=0.00 avg300=0.00 total=12345"
+  char buffer[256];
+  ssize_t length = ::pread(m_pressureFd, buffer, sizeof(buffer) - 1, 0);
+  if (length <= 0) {
+    return -1;
+  }
+  buffer[length] = '\0';
+
+  const char *total = std::strstr(buffer, "total=");
+  if (total == nullptr || std::strncmp(buffer, "some", 4) != 0) {
+    return -1;
+  }
+
+  return std::strtoll(total + 6, nullptr, 10);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "cpucontroller.h"
+#include <QElapsedTimer>
+#include <QObject>
+#include <QVariantMap>
+#include <vector>
+
+// What the protection cost over some period
+struct ThrottleTotals {
+  double sampledSeconds = 0.0;
+  double throttledSeconds = 0.0;
+  double frequencySecondsLost = 0.0; // GHz·s below the restored ceiling
+  int engagements = 0;
+  double longestEngagementSeconds = 0.0; // Of engagements that ended
+  double stallSeconds = 0.0;             // PSI cpu "some" stall time
+  double throttledStallSeconds = 0.0;    // Stall time while throttled
+
+  void add(const ThrottleTotals &other);
+  QVariantMap toVariantMap() const;
+  static ThrottleTotals fromVariantMap(const QVariantMap &totals);
+};
+
+// Totals of a sliding window in a fixed ring of buckets, so memory and the
+// cost of a sum do not grow with the uptime
+class RollingTotals {
+public:
+  RollingTotals(int bucketCount, qint64 bucketMs);
+
+  void add(qint64 nowMs, const ThrottleTotals &delta);
+  ThrottleTotals sum(qint64 nowMs) const;
+
+private:
+  struct Bucket {
+    qint64 index = -1; // nowMs / bucketMs of the bucket's period
+    ThrottleTotals totals;
+  };
+
+  std::vector<Bucket> m_buckets;
+  qint64 m_bucketMs;
+};
+
+// Accounts the performance cost of the CPU frequency limit: throttled time,
+// frequency-seconds lost, engagements and the CPU pressure stall time
+// (/proc/pressure/cpu) while throttled, for correlation with the time
+// outside the limit
+class ThrottleAccounting : public QObject {
+  Q_OBJECT
+
+public:
+  explicit ThrottleAccounting(CpuController *cpuController,
+                              QObject *parent = nullptr);
+  ~ThrottleAccounting() override;
+
+  // "boot", "lastHour" and "lastDay" totals, plus whether the limit is
+  // engaged right now and for how long
+  QVariantMap report() const;
+
+  ThrottleTotals bootTotals() const { return m_bootTotals; }
+
+  // Keeps the boot totals in path across daemon restarts, tagged with the
+  // kernel's boot_id. Totals of an earlier boot are discarded.
+  void setStatePath(const QString &path);
+
+public slots:
+  // Called by the daemon's tick scheduler, accounts the interval since the
+  // previous call with the state sampled then
+  void sample();
+
+private:
+  // PSI cpu "some" total in microseconds, -1 without PSI support
+  qint64 readCpuStallMicroseconds();
+  void account(qint64 nowMs, const ThrottleTotals &delta);
+  void saveState();
+  static QString readBootId();
+
+  CpuController *m_cpuController;
+  QElapsedTimer m_clock;
+
+  ThrottleTotals m_bootTotals;
+  QString m_statePath;
+  QString m_bootId;
+  qint64 m_lastSaveMs = 0;
+  RollingTotals m_lastHour;
+  RollingTotals m_lastDay;
+
+  int m_pressureFd = -1; // /proc/pressure/cpu, kept open for re-reads
+  qint64 m_lastStallUs = -1;
+  qint64 m_lastSampleMs = -1;
+  bool m_engaged = false;
+  double m_lostGHz = 0.0; // Ceiling minus limit at the last sample
+  qint64 m_engagementStartMs = 0;
+};
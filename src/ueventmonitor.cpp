@@ -0,0 +1,124 @@
+#include "ueventmonitor.h"
+#include <QDebug>
+#include <QList>
+#include <QSocketNotifier>
+#include <cerrno>
+#include <cstring>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+// Multicast group of the raw kernel events, group 2 is used by udev for its
+// own rebroadcast with a different format
+constexpr unsigned int kKernelEventGroup = 1;
+constexpr int kReceiveBufferSize = 1024 * 1024;
+} // namespace
+
+UeventMonitor::UeventMonitor(QObject *parent) : QObject(parent) {}
+
+UeventMonitor::~UeventMonitor() {
+  if (m_socket >= 0) {
+    ::close(m_socket);
+  }
+}
+
+bool UeventMonitor::start() {
+  if (m_socket >= 0) {
+    return true;
+  }
+
+  m_socket = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+                      NETLINK_KOBJECT_UEVENT);
+  if (m_socket < 0) {
+    qWarning() << "Failed to open uevent socket:" << std::strerror(errno);
+    return false;
+  }
+
+  // Driver loads can emit bursts of events, don't lose them
+  int bufferSize = kReceiveBufferSize;
+  if (::setsockopt(m_socket, SOL_SOCKET, SO_RCVBUFFORCE, &bufferSize,
+                   sizeof(bufferSize)) < 0) {
+    ::setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, &bufferSize,
+                 sizeof(bufferSize));
+  }
+
+  sockaddr_nl address = {};
+  address.nl_family = AF_NETLINK;
+  address.nl_groups = kKernelEventGroup;
+  if (::bind(m_socket, reinterpret_cast<sockaddr *>(&address),
+             sizeof(address)) < 0) {
+    qWarning() << "Failed to bind uevent socket:" << std::strerror(errno);
+    ::close(m_socket);
+    m_socket = -1;
+    return false;
+  }
+
+  m_notifier = new QSocketNotifier(m_socket, QSocketNotifier::Read, this);
+  connect(m_notifier, &QSocketNotifier::activated, this,
+          &UeventMonitor::onReadyRead);
+
+  qDebug() << "Listening for kernel uevents";
+  return true;
+}
+
+bool UeventMonitor::parse(const QByteArray &message, Uevent *event) {
+  const QList<QByteArray> fields = message.split('\0');
+
+  // Kernel events start with "ACTION@DEVPATH", udev's with "libudev"
+  if (fields.isEmpty() || !fields.first().contains('@')) {
+    return false;
+  }
+
+  event->properties.clear();
+  for (int i = 1; i < fields.size(); ++i) {
+    const QByteArray &field = fields[i];
+    int separator = field.indexOf('=');
+    if (separator > 0) {
+      event->properties.insert(QString::fromUtf8(field.left(separator)),
+                               QString::fromUtf8(field.mid(separator + 1)));
+    }
+  }
+
+  event->action = event->properties.value("ACTION");
+  event->devpath = event->properties.value("DEVPATH");
+  event->subsystem = event->properties.value("SUBSYSTEM");
+
+  return !event->action.isEmpty() && !event->devpath.isEmpty();
+}
+
+void UeventMonitor::onReadyRead() {
+  char buffer[8192];
+
+  for (;;) {
+    sockaddr_nl sender = {};
+    iovec vector = {buffer, sizeof(buffer)};
+    msghdr header = {};
+    header.msg_name = &sender;
+    header.msg_namelen = sizeof(sender);
+    header.msg_iov = &vector;
+    header.msg_iovlen = 1;
+
+    ssize_t length = ::recvmsg(m_socket, &header, 0);
+    if (length < 0) {
+      if (errno == ENOBUFS) {
+        qWarning() << "Uevent socket overflowed, rebuilding bindings";
+        emit overflowed();
+        continue;
+      }
+
+      // EAGAIN, everything has been read
+      return;
+    }
+
+    // Only trust events sent by the kernel itself
+    if (sender.nl_pid != 0 || length == 0) {
+      continue;
+    }
+
+    Uevent event;
+    if (parse(QByteArray(buffer, static_cast<int>(length)), &event)) {
+      emit ueventReceived(event);
+    }
+  }
+}
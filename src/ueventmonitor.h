@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QByteArray>
+#include <QMap>
+#include <QObject>
+#include <QString>
+
+class QSocketNotifier;
+
+struct Uevent {
+  QString action;    // "add", "remove", "online", "offline", ...
+  QString devpath;   // e.g. /devices/platform/nct6775.656/hwmon/hwmon3
+  QString subsystem; // e.g. "hwmon", "drm" or "cpu"
+  QMap<QString, QString> properties;
+};
+
+// Listens for kernel uevents on a NETLINK_KOBJECT_UEVENT socket, so sensor
+// bindings can follow drivers that load late, GPU resets and CPU hotplug
+// without any polling
+class UeventMonitor : public QObject {
+  Q_OBJECT
+
+public:
+  explicit UeventMonitor(QObject *parent = nullptr);
+  ~UeventMonitor() override;
+
+  bool start();
+
+  // Parses a kernel uevent datagram: "ACTION@DEVPATH\0KEY=VALUE\0..."
+  static bool parse(const QByteArray &message, Uevent *event);
+
+signals:
+  void ueventReceived(const Uevent &event);
+
+  // Events were dropped by the kernel, bindings have to be rebuilt from
+  // scratch
+  void overflowed();
+
+private slots:
+  void onReadyRead();
+
+private:
+  int m_socket = -1;
+  QSocketNotifier *m_notifier = nullptr;
+};